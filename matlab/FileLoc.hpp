@@ -51,7 +51,7 @@ typedef class FileLoc _YYLTYPE;
         YYRHSLOC(Rhs, 0).last_line;                                     \
       (Current).first_column = (Current).last_column =                  \
         YYRHSLOC(Rhs, 0).last_column;                                   \
-      (Current).filename  = prefix._curfilename; /* new */              \
+      (Current).filename  = prefix.filename; /* new */                  \
       (Current).rawtext  = "?";                          /* new */      \
     }                                                                   \
   } while (0)
@@ -0,0 +1,262 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// allocation counting for benchmark and test programs
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Include this in exactly one file of a program (never in the library or
+// a mex file): it replaces malloc/calloc/realloc/free, so the parser's
+// strdup()s and everything operator new does are seen too.  Then
+//
+//   AllocMark mark;
+//   ldrs.loadFile(filename);
+//   AllocStats used = mark.since();  // allocs, bytes, peak heap & rss
+//
+// Where malloc can't be replaced (not glibc, or a sanitizer build, which
+// has its own) only operator new is counted, without the peak heap, and
+// AllocProf::mallocs() says so.  The rss high water mark can only be
+// reset on linux, elsewhere it's the process lifetime's.
+//
+#ifndef ALLOCPROF_HPP
+#define ALLOCPROF_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define ALLOCPROF_MALLOC 1
+#include <malloc.h>
+extern "C" {
+  void * __libc_malloc(size_t);
+  void * __libc_calloc(size_t, size_t);
+  void * __libc_realloc(void *, size_t);
+  void * __libc_memalign(size_t, size_t);
+  void __libc_free(void *);
+}
+#else
+#define ALLOCPROF_MALLOC 0
+#endif
+
+struct AllocStats
+{
+  uint64_t allocs;      //!< calls to malloc & friends (or operator new)
+  uint64_t frees;
+  uint64_t bytes;       //!< requested, in total
+  uint64_t peak;        //!< most heap in use at once, above what was in use at the start
+  int64_t retained;     //!< heap still in use, above what was at the start (leaks)
+  uint64_t peak_rss;    //!< process high water mark, bytes
+};
+
+class AllocProf
+{
+public:
+  //! true if malloc is counted, not just operator new
+  static bool mallocs() { return ALLOCPROF_MALLOC; }
+
+  static void counted(void * ptr, size_t size, size_t usable)
+  {
+    if (!ptr)
+      return;
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    s_bytes.fetch_add(size, std::memory_order_relaxed);
+    uint64_t live = s_live.fetch_add(usable, std::memory_order_relaxed) + usable;
+    uint64_t peak = s_peak.load(std::memory_order_relaxed);
+    while (live > peak && !s_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+      ;
+  }
+
+  static void uncounted(size_t usable)
+  {
+    s_frees.fetch_add(1, std::memory_order_relaxed);
+    s_live.fetch_sub(usable, std::memory_order_relaxed);
+  }
+
+  static AllocStats now()
+  {
+    AllocStats stats;
+    stats.allocs = s_allocs.load(std::memory_order_relaxed);
+    stats.frees = s_frees.load(std::memory_order_relaxed);
+    stats.bytes = s_bytes.load(std::memory_order_relaxed);
+    stats.peak = s_peak.load(std::memory_order_relaxed);
+    stats.retained = s_live.load(std::memory_order_relaxed);
+    stats.peak_rss = peakRss();
+    return stats;
+  }
+
+  //! start the heap & rss high water marks over from what's in use now
+  static uint64_t resetPeak()
+  {
+    uint64_t live = s_live.load(std::memory_order_relaxed);
+    s_peak.store(live, std::memory_order_relaxed);
+#ifdef __linux__
+    // "5" resets VmHWM to the current rss (linux 4.0 on)
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd >= 0) {
+      if (write(fd, "5", 1) != 1) {}
+      close(fd);
+    }
+#endif
+    return live;
+  }
+
+  //! VmHWM where it can be reset, otherwise the lifetime maximum
+  static uint64_t peakRss()
+  {
+#ifdef __linux__
+    // read(), not stdio, which would allocate
+    int fd = open("/proc/self/status", O_RDONLY);
+    if (fd >= 0) {
+      char status[4096];
+      ssize_t len = read(fd, status, sizeof(status) - 1);
+      close(fd);
+      status[len > 0 ? len : 0] = '\0';
+      if (const char * hwm = strstr(status, "VmHWM:"))
+        return strtoull(hwm + 6, NULL, 10) * 1024;
+    }
+#endif
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+  }
+
+private:
+  static std::atomic<uint64_t> s_allocs, s_frees, s_bytes, s_live, s_peak;
+};
+
+std::atomic<uint64_t> AllocProf::s_allocs(0);
+std::atomic<uint64_t> AllocProf::s_frees(0);
+std::atomic<uint64_t> AllocProf::s_bytes(0);
+std::atomic<uint64_t> AllocProf::s_live(0);
+std::atomic<uint64_t> AllocProf::s_peak(0);
+
+//! what was allocated between its construction and since()
+class AllocMark
+{
+public:
+  AllocMark() { reset(); }
+
+  void reset()
+  {
+    _base = AllocProf::resetPeak();
+    _start = AllocProf::now();
+  }
+
+  AllocStats since() const
+  {
+    AllocStats stats = AllocProf::now();
+    stats.allocs -= _start.allocs;
+    stats.frees -= _start.frees;
+    stats.bytes -= _start.bytes;
+    stats.peak = stats.peak > _base ? stats.peak - _base : 0;
+    stats.retained -= _start.retained;
+    return stats;
+  }
+
+private:
+  uint64_t _base;
+  AllocStats _start;
+};
+
+#if ALLOCPROF_MALLOC
+
+extern "C" {
+
+void * malloc(size_t size)
+{
+  void * ptr = __libc_malloc(size);
+  AllocProf::counted(ptr, size, ptr ? malloc_usable_size(ptr) : 0);
+  return ptr;
+}
+
+void * calloc(size_t nmemb, size_t size)
+{
+  void * ptr = __libc_calloc(nmemb, size);
+  AllocProf::counted(ptr, nmemb * size, ptr ? malloc_usable_size(ptr) : 0);
+  return ptr;
+}
+
+void * realloc(void * old, size_t size)
+{
+  if (!old)
+    return malloc(size);
+  size_t was = malloc_usable_size(old);
+  void * ptr = __libc_realloc(old, size);
+  if (ptr || !size) {
+    // counted as a free of the old block and a new allocation
+    AllocProf::uncounted(was);
+    AllocProf::counted(ptr, size, ptr ? malloc_usable_size(ptr) : 0);
+  }
+  return ptr;
+}
+
+void free(void * ptr)
+{
+  if (!ptr)
+    return;
+  AllocProf::uncounted(malloc_usable_size(ptr));
+  __libc_free(ptr);
+}
+
+void * memalign(size_t align, size_t size)
+{
+  void * ptr = __libc_memalign(align, size);
+  AllocProf::counted(ptr, size, ptr ? malloc_usable_size(ptr) : 0);
+  return ptr;
+}
+
+void * aligned_alloc(size_t align, size_t size)
+{
+  return memalign(align, size);
+}
+
+int posix_memalign(void ** out, size_t align, size_t size)
+{
+  void * ptr = memalign(align, size);
+  if (!ptr)
+    return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+
+} // extern "C"
+
+#else
+
+// operator new only.  kept out of line so gcc doesn't pair the malloc/free
+// inside them with new/delete
+__attribute__((noinline)) void * operator new(size_t size)
+{
+  void * ptr = std::malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  AllocProf::counted(ptr, size, 0);
+  return ptr;
+}
+__attribute__((noinline)) void * operator new[](size_t size)
+{
+  return operator new(size);
+}
+__attribute__((noinline)) void operator delete(void * ptr) noexcept
+{
+  if (ptr)
+    AllocProf::uncounted(0);
+  std::free(ptr);
+}
+__attribute__((noinline)) void operator delete[](void * ptr) noexcept { operator delete(ptr); }
+__attribute__((noinline)) void operator delete(void * ptr, size_t) noexcept { operator delete(ptr); }
+__attribute__((noinline)) void operator delete[](void * ptr, size_t) noexcept { operator delete(ptr); }
+
+#endif // ALLOCPROF_MALLOC
+
+#endif // ALLOCPROF_HPP
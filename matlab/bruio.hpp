@@ -0,0 +1,217 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// low-level helpers for reading bruker binary data files
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#ifndef BRUIO_HPP
+#define BRUIO_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//! on-disk sample types, numbered like DTYPA/DTYPP
+enum bru_dtype {
+  BRU_INT32 = 0,
+  BRU_FLOAT32 = 1,
+  BRU_FLOAT64 = 2,
+  BRU_INT16 = 3,
+  BRU_UINT8 = 4,
+};
+
+inline size_t
+bru_dtype_size(bru_dtype dtype)
+{
+  switch (dtype) {
+  case BRU_INT32:   return 4;
+  case BRU_FLOAT32: return 4;
+  case BRU_FLOAT64: return 8;
+  case BRU_INT16:   return 2;
+  case BRU_UINT8:   return 1;
+  }
+  throw std::invalid_argument("bru_dtype_size: unknown data type");
+}
+
+inline bool
+bru_host_bigendian()
+{
+  const uint16_t one = 1;
+  return *(const uint8_t *)&one == 0;
+}
+
+//! convert 'count' samples of 'dtype' from 'src' to doubles, y = x * scale + offset
+//
+// 'swap' reverses the byte order of each sample first.  the loops are kept
+// simple so that the compiler can vectorize the common (non-swapped) case.
+template <typename T>
+inline void
+bru_convert(const void * src, bru_dtype dtype, bool swap, size_t count,
+            T * dst, double scale = 1, double offset = 0)
+{
+  const uint8_t * s = (const uint8_t *)src;
+  switch (dtype) {
+  case BRU_INT32:
+    for (size_t ii = 0; ii < count; ii++) {
+      uint32_t u;
+      memcpy(&u, s + 4 * ii, 4);
+      if (swap)
+        u = (u >> 24) | ((u >> 8) & 0xff00) | ((u << 8) & 0xff0000) | (u << 24);
+      dst[ii] = (T)((int32_t)u * scale + offset);
+    }
+    break;
+  case BRU_FLOAT32:
+    for (size_t ii = 0; ii < count; ii++) {
+      uint32_t u;
+      float f;
+      memcpy(&u, s + 4 * ii, 4);
+      if (swap)
+        u = (u >> 24) | ((u >> 8) & 0xff00) | ((u << 8) & 0xff0000) | (u << 24);
+      memcpy(&f, &u, 4);
+      dst[ii] = (T)(f * scale + offset);
+    }
+    break;
+  case BRU_FLOAT64:
+    for (size_t ii = 0; ii < count; ii++) {
+      uint64_t u;
+      double d;
+      memcpy(&u, s + 8 * ii, 8);
+      if (swap) {
+        uint64_t r = 0;
+        for (int bb = 0; bb < 8; bb++)
+          r = (r << 8) | ((u >> (8 * bb)) & 0xff);
+        u = r;
+      }
+      memcpy(&d, &u, 8);
+      dst[ii] = (T)(d * scale + offset);
+    }
+    break;
+  case BRU_INT16:
+    for (size_t ii = 0; ii < count; ii++) {
+      uint16_t u;
+      memcpy(&u, s + 2 * ii, 2);
+      if (swap)
+        u = (uint16_t)((u >> 8) | (u << 8));
+      dst[ii] = (T)((int16_t)u * scale + offset);
+    }
+    break;
+  case BRU_UINT8:
+    for (size_t ii = 0; ii < count; ii++)
+      dst[ii] = (T)(s[ii] * scale + offset);
+    break;
+  }
+}
+
+//! seek to a 64-bit offset in 'fp', throw on failure
+inline void
+bru_fseek(FILE * fp, uint64_t offset, const std::string & filename)
+{
+#if defined(_WIN32)
+  int rc = _fseeki64(fp, (__int64)offset, SEEK_SET);
+#else
+  int rc = fseeko(fp, (off_t)offset, SEEK_SET);
+#endif
+  if (rc) {
+    std::stringstream str;
+    str << "seek failed: " << filename << "@" << offset << ": " << strerror(errno);
+    throw std::runtime_error(str.str());
+  }
+}
+
+//! read exactly 'bytes' from 'fp', throw on a short read
+inline void
+bru_fread(void * buf, size_t bytes, FILE * fp, const std::string & filename)
+{
+  if (fread(buf, 1, bytes, fp) != bytes) {
+    std::stringstream str;
+    str << "short read: " << filename << ": " << (feof(fp) ? "end of file" : strerror(errno));
+    throw std::runtime_error(str.str());
+  }
+}
+
+//! read-only view of a whole file, mmap'd where possible
+class MappedFile
+{
+public:
+  MappedFile(const std::string & filename)
+    : _filename(filename), _data(NULL), _size(0)
+  {
+#if !defined(_WIN32)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+      std::stringstream str;
+      str << "invalid input file: " << filename << ": " << strerror(errno) << "\n";
+      if (fd >= 0)
+        ::close(fd);
+      throw std::invalid_argument(str.str());
+    }
+    _size = (size_t)st.st_size;
+    if (_size) {
+      void * addr = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        std::stringstream str;
+        str << "mmap failed: " << filename << ": " << strerror(errno);
+        ::close(fd);
+        throw std::runtime_error(str.str());
+      }
+      _data = (const uint8_t *)addr;
+#ifdef MADV_SEQUENTIAL
+      madvise(addr, _size, MADV_SEQUENTIAL);
+#endif
+    }
+    ::close(fd);
+#else
+    FILE * fp = fopen(filename.c_str(), "rb");
+    if (!fp) {
+      std::stringstream str;
+      str << "invalid input file: " << filename << ": " << strerror(errno) << "\n";
+      throw std::invalid_argument(str.str());
+    }
+    char buf[1 << 16];
+    size_t nn;
+    while ((nn = fread(buf, 1, sizeof(buf), fp)) > 0)
+      _buf.insert(_buf.end(), buf, buf + nn);
+    fclose(fp);
+    _size = _buf.size();
+    _data = _size ? &_buf[0] : NULL;
+#endif
+  }
+
+  ~MappedFile()
+  {
+#if !defined(_WIN32)
+    if (_data)
+      munmap((void *)_data, _size);
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+
+  const uint8_t * data() const { return _data; }
+  size_t size() const { return _size; }
+  const std::string & filename() const { return _filename; }
+
+private:
+  std::string _filename;
+  const uint8_t * _data;
+  size_t _size;
+#if defined(_WIN32)
+  std::vector<uint8_t> _buf;
+#endif
+};
+
+#endif // BRUIO_HPP
@@ -4,7 +4,17 @@ if isOctave
     oldf = mkoctfile('-p', 'CXXFLAGS');
     setenv('CXXFLAGS', [' -std=c++11 ' strtrim(oldf) ]);
     mex -v mexldr.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+    mex -v mexpdata.cpp procdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+    mex -v mex2dseq.cpp visudata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp -pthread
+    mex -v mexbrulist.cpp brulist.cpp
+    mex -v mexrawdata.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp -pthread
+    mex -v mexfidproc.cpp fidproc.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp -pthread
 else
     mex -v mexldr.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC"
+    mex -v mexpdata.cpp procdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC"
+    mex -v mex2dseq.cpp visudata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC -pthread"
+    mex -v mexbrulist.cpp brulist.cpp CXXFLAGS="-std=c++11 -fPIC"
+    mex -v mexrawdata.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC -pthread"
+    mex -v mexfidproc.cpp fidproc.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC -pthread"
 
 end
\ No newline at end of file
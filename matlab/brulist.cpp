@@ -0,0 +1,191 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for bruker list files: vdlist, vclist, vplist, fq1list...
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "brulist.hpp"
+
+BruList::BruList()
+{
+}
+
+BruList::BruList(const string & filename, double unitscale, bool fqlist)
+{
+  loadFile(filename, unitscale, fqlist);
+}
+
+void
+BruList::loadFile(const string & filename, double unitscale, bool fqlist)
+{
+  FILE * fp = fopen(filename.c_str(), "rb");
+  if (!fp) {
+    std::stringstream str;
+    str << "invalid input file: " << filename << ": " << strerror(errno) << "\n";
+    throw std::invalid_argument(str.str());
+  }
+  string text;
+  char buf[4096];
+  size_t nn;
+  while ((nn = fread(buf, 1, sizeof(buf), fp)) > 0)
+    text.append(buf, nn);
+  fclose(fp);
+  parse(text.c_str(), text.size(), unitscale, filename, fqlist);
+}
+
+void
+BruList::loadString(const string & text, double unitscale, const string & nametag, bool fqlist)
+{
+  parse(text.c_str(), text.size(), unitscale, nametag, fqlist);
+}
+
+size_t
+BruList::size() const
+{
+  return _values.size();
+}
+
+double
+BruList::at(size_t idx) const
+{
+  return _values.at(idx);
+}
+
+const string &
+BruList::reference() const
+{
+  return _reference;
+}
+
+const std::vector<double> &
+BruList::values() const
+{
+  return _values;
+}
+
+static inline bool
+isblank_(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+// true if [p,q) is 'word' (any case), then any digits if 'digits'
+static bool
+isword(const char * p, const char * q, const char * word, bool digits)
+{
+  for (; *word; word++, p++)
+    if (p == q || tolower((unsigned char)*p) != *word)
+      return false;
+  for (; digits && p < q && isdigit((unsigned char)*p); p++)
+    ;
+  return p == q;
+}
+
+// an fq list reference header: "bf" or "sfo" (maybe numbered) then "ppm" or "hz"
+static bool
+isreference(const char * p, const char * q)
+{
+  const char * sep = p;
+  while (sep < q && !isblank_(*sep))
+    sep++;
+  const char * unit = sep;
+  while (unit < q && isblank_(*unit))
+    unit++;
+  if (unit == sep || unit == q)
+    return false;
+  return (isword(p, sep, "bf", true) || isword(p, sep, "sfo", true)) &&
+    (isword(unit, q, "ppm", false) || isword(unit, q, "hz", false));
+}
+
+// 'text' must be nul-terminated at text[len]
+void
+BruList::parse(const char * text, size_t len, double unitscale, const string & nametag,
+               bool fqlist)
+{
+  const char * end = text + len;
+  double offset = 0;
+  int lineno = 0;
+
+  _values.clear();
+  _reference.clear();
+
+  for (const char * line = text; line < end; ) {
+    const char * eol = (const char *)memchr(line, '\n', end - line);
+    if (!eol)
+      eol = end;
+    lineno++;
+
+    // trim comments & whitespace
+    const char * p = line;
+    const char * q = eol;
+    for (const char * c = p; c < q; c++)
+      if (*c == '#' || *c == ';') {
+        q = c;
+        break;
+      }
+    while (p < q && isblank_(*p))
+      p++;
+    while (q > p && isblank_(q[-1]))
+      q--;
+    line = eol + 1;
+    if (p == q)
+      continue;
+
+    // fq list reference header, only before the first entry
+    if (fqlist && _values.empty() && offset == 0 && isreference(p, q)) {
+      _reference.assign(p, q);
+      for (auto & c : _reference)
+        c = tolower(c);
+      continue;
+    }
+
+    // "O <offset>" applies to the following fq list entries
+    bool isoffset = false;
+    if (fqlist && (*p == 'O' || *p == 'o') && p + 1 < q && isblank_(p[1])) {
+      isoffset = true;
+      for (p++; p < q && isblank_(*p); p++)
+        ;
+    }
+
+    char * numend;
+    double val = strtod(p, &numend);
+    if (numend == p || numend > q) {
+      std::stringstream str;
+      str << "unformatted line " << lineno << " in file " << nametag << ": '"
+          << string(p, q) << "'";
+      throw std::invalid_argument(str.str());
+    }
+    for (p = numend; p < q && isblank_(*p); p++)
+      ;
+
+    double scale = unitscale;
+    if (p < q) {
+      switch (*p++) {
+      case 'n': scale = 1e-9; break;
+      case 'u': scale = 1e-6; break;
+      case 'm': scale = 1e-3; break;
+      case 's': scale = 1; break;
+      default: p = q + 1;
+      }
+      if (p != q) {
+        std::stringstream str;
+        str << "bad unit on line " << lineno << " in file " << nametag << ": '"
+            << string((const char *)numend, q) << "'";
+        throw std::invalid_argument(str.str());
+      }
+    }
+
+    if (isoffset)
+      offset = val;
+    else
+      _values.push_back(val * scale + offset);
+  }
+}
@@ -0,0 +1,50 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for bruker list files: vdlist, vclist, vplist, fq1list...
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// one entry per line, optionally followed by a unit suffix:
+//   n - nanoseconds, u - microseconds, m - milliseconds, s - seconds
+// entries without a unit are scaled by the caller's default.  blank
+// lines and anything after '#' or ';' are ignored.  frequency lists (read
+// with 'fqlist') may start with a reference header, "bf" or "sfo" and
+// "ppm" or "hz" (ie "bf ppm", "SFO1 Hz"), and may contain "O <offset>"
+// lines, the offset is added to the entries that follow it.  anything
+// else that isn't a number is an error.
+//
+#ifndef BRULIST_HPP
+#define BRULIST_HPP
+
+#include <string>
+#include <vector>
+using std::string;
+
+class BruList
+{
+public:
+  BruList();
+  //! parse the list file 'filename', see loadFile()
+  BruList(const string & filename, double unitscale = 1.0, bool fqlist = false);
+
+  //! parse a list file, entries without a unit suffix are multiplied by
+  //! 'unitscale'.  'fqlist' allows the fq list header and offsets
+  void loadFile(const string & filename, double unitscale = 1.0, bool fqlist = false);
+  void loadString(const string & text, double unitscale = 1.0, const string & nametag = "string",
+                  bool fqlist = false);
+
+  size_t size() const;
+  double at(size_t idx) const;
+  //! the fq list reference header, ie "bf ppm", or "" if there was none
+  const string & reference() const;
+  const std::vector<double> & values() const;
+
+private:
+  void parse(const char * text, size_t len, double unitscale, const string & nametag,
+             bool fqlist);
+
+  std::vector<double> _values;
+  string _reference;
+};
+
+#endif // BRULIST_HPP
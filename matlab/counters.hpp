@@ -0,0 +1,118 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// named event counters, cheap enough to leave on in release builds
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// A Counter registers itself by name when it's constructed, normally as a
+// static at file scope (or in a function, which DEBUG_EVENT does).  add()
+// is one relaxed atomic add on a slot picked per thread, so threads
+// counting the same thing don't fight over one cache line.  Counters with
+// the same name are summed in snapshots.  build with -DNO_COUNTERS to
+// compile the adds out.
+//
+#ifndef COUNTERS_HPP
+#define COUNTERS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Counter
+{
+public:
+  static const unsigned SHARDS = 16;
+
+  explicit Counter(const char * name) : _name(name)
+  {
+    for (auto & slot : _slots)
+      slot.count.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex());
+    registry().push_back(this);
+  }
+
+  ~Counter()
+  {
+    std::lock_guard<std::mutex> lock(mutex());
+    auto & all = registry();
+    all.erase(std::remove(all.begin(), all.end(), this), all.end());
+  }
+
+  Counter(const Counter &) = delete;
+  Counter & operator=(const Counter &) = delete;
+
+  void add(uint64_t nn = 1)
+  {
+#ifndef NO_COUNTERS
+    _slots[shard()].count.fetch_add(nn, std::memory_order_relaxed);
+#endif
+  }
+
+  //! the sum over all threads, only exact if they've stopped counting
+  uint64_t value() const
+  {
+    uint64_t sum = 0;
+    for (auto & slot : _slots)
+      sum += slot.count.load(std::memory_order_relaxed);
+    return sum;
+  }
+
+  void reset()
+  {
+    for (auto & slot : _slots)
+      slot.count.store(0, std::memory_order_relaxed);
+  }
+
+  const char * name() const { return _name; }
+
+  //! every registered counter's value, by name
+  static std::map<std::string, uint64_t> snapshot()
+  {
+    std::map<std::string, uint64_t> values;
+    std::lock_guard<std::mutex> lock(mutex());
+    for (auto counter : registry())
+      values[counter->name()] += counter->value();
+    return values;
+  }
+
+  static void resetAll()
+  {
+    std::lock_guard<std::mutex> lock(mutex());
+    for (auto counter : registry())
+      counter->reset();
+  }
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> count;
+  };
+
+  // each thread gets the next slot, round robin
+  static unsigned shard()
+  {
+    static std::atomic<unsigned> next(0);
+    thread_local unsigned mine = next++ % SHARDS;
+    return mine;
+  }
+
+  static std::vector<Counter *> & registry()
+  {
+    static std::vector<Counter *> all;
+    return all;
+  }
+
+  static std::mutex & mutex()
+  {
+    static std::mutex mtx;
+    return mtx;
+  }
+
+  const char * _name;
+  Slot _slots[SHARDS];
+};
+
+#endif // COUNTERS_HPP
@@ -5,8 +5,18 @@
  * (c)2016 Michael Tesch. tesch1@gmail.com
  */
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include "counters.hpp"
 #ifdef CIO
 #include "cio.hpp"
 #else
@@ -15,10 +25,29 @@ using std::string;
 #endif
 
 enum DebugLevel { LEVEL_ALL, LEVEL_ERROR, LEVEL_WARN, LEVEL_INFO, LEVEL_INFO2 };
-extern DebugLevel g_debug_level;
-void SetDebugLevel(DebugLevel);
-void DebugFunc(DebugLevel level, string str, string location);
-bool GetNextErrorMsg(string & msg, DebugLevel & level);
+//! atomic so it can be changed while other threads are parsing
+extern std::atomic<DebugLevel> g_debug_level;
+//! defined by each program, gets every message that passes g_debug_level
+void DebugFunc(DebugLevel level, const char * str, const char * location);
+
+//! the most verbose level compiled in, messages above it compile to nothing
+#ifndef DEBUG_MAX_LEVEL
+#ifdef NDEBUG
+#define DEBUG_MAX_LEVEL 3 /* LEVEL_INFO */
+#else
+#define DEBUG_MAX_LEVEL 4 /* LEVEL_INFO2 */
+#endif
+#endif
+
+inline void SetDebugLevel(DebugLevel level)
+{
+    g_debug_level.store(level, std::memory_order_relaxed);
+}
+
+inline bool DebugEnabled(DebugLevel level)
+{
+    return level <= DEBUG_MAX_LEVEL && level <= g_debug_level.load(std::memory_order_relaxed);
+}
 
 //! aborts on failing stod conversions
 double x_stod(const string & str);
@@ -45,24 +74,207 @@ constexpr cstr past_last_slash(cstr str)
 #define __SHORT_FILE__ ""
 #endif
 
+/**
+ * The newest ERROR and WARN messages, for callers that would rather poll
+ * than have DebugFunc called (ie. a gui).  Bounded and lock free
+ * (Vyukov's mpmc ring), so logging threads never wait on the reader;
+ * when it's full the oldest message makes room for the new one, and is
+ * counted in debug.dropped.
+ */
+class DebugQueue
+{
+public:
+    static const size_t SIZE = 64;     //!< a power of 2
+    static const size_t MSGLEN = 256;  //!< longer messages are cut
+
+    DebugQueue() : _push(0), _pop(0)
+    {
+        for (size_t ii = 0; ii < SIZE; ii++)
+            _cells[ii].seq.store(ii, std::memory_order_relaxed);
+    }
+
+    void push(DebugLevel level, const char * msg)
+    {
+        size_t pos = _push.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell & cell = _cells[pos & (SIZE - 1)];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (_push.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.level = level;
+                    size_t len = strnlen(msg, MSGLEN - 1);
+                    memcpy(cell.msg, msg, len);
+                    cell.msg[len] = '\0';
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            }
+            else if (dif < 0) {
+                // full, make room by dropping the oldest
+                static Counter dropped("debug.dropped");
+                if (take(NULL, NULL))
+                    dropped.add();
+                pos = _push.load(std::memory_order_relaxed);
+            }
+            else
+                pos = _push.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool pop(string & msg, DebugLevel & level)
+    {
+        return take(&msg, &level);
+    }
+
+    static DebugQueue & errors()
+    {
+        static DebugQueue queue;
+        return queue;
+    }
+
+private:
+    //! the oldest message into 'msg' & 'level', or dropped if they're NULL
+    bool take(string * msg, DebugLevel * level)
+    {
+        size_t pos = _pop.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell & cell = _cells[pos & (SIZE - 1)];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (_pop.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    if (msg) {
+                        *msg = cell.msg;
+                        *level = cell.level;
+                    }
+                    cell.seq.store(pos + SIZE, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = _pop.load(std::memory_order_relaxed);
+        }
+    }
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        DebugLevel level;
+        char msg[MSGLEN];
+    };
+    Cell _cells[SIZE];
+    alignas(64) std::atomic<size_t> _push;
+    alignas(64) std::atomic<size_t> _pop;
+};
+
+//! the oldest queued ERROR / WARN message, false if there are none
+inline bool GetNextErrorMsg(string & msg, DebugLevel & level)
+{
+    return DebugQueue::errors().pop(msg, level);
+}
+
+/**
+ * One message being formatted.  The text goes into a buffer kept per
+ * thread, so an enabled message costs the formatting and no allocations.
+ * Messages formatted while formatting another (an operator<< that logs)
+ * get a stringstream of their own.
+ */
+class DebugLog
+{
+public:
+    static const size_t BUFLEN = 1024;  //!< longer messages are cut, ending in ...
+
+    explicit DebugLog(DebugLevel level) : _level(level), _line(line())
+    {
+        if (_line.busy)
+            _spare.reset(new std::ostringstream);
+        _line.busy = true;
+    }
+    ~DebugLog()
+    {
+        if (!_spare) {
+            _line.reset();
+            _line.busy = false;
+        }
+    }
+    DebugLog(const DebugLog &) = delete;
+    DebugLog & operator=(const DebugLog &) = delete;
+
+    std::ostream & stream() { return _spare ? *_spare : _line.os; }
+
+    void emit(const char * file, int lineno)
+    {
+        char loc[128];
+        snprintf(loc, sizeof(loc), "%s:%d", file, lineno);
+        string spare;
+        const char * msg = _spare ? (spare = _spare->str()).c_str() : _line.str();
+        if (_level <= LEVEL_WARN)
+            DebugQueue::errors().push(_level, msg);
+        DebugFunc(_level, msg, loc);
+    }
+
+private:
+    class Buf : public std::streambuf
+    {
+    public:
+        Buf() { reset(); }
+        void reset() { setp(_buf, _buf + BUFLEN - 4); }
+        const char * str()
+        {
+            char * end = pptr();
+            if (end == epptr())
+                end = std::copy_n("...", 3, end);
+            *end = '\0';
+            return _buf;
+        }
+    private:
+        char _buf[BUFLEN];
+    };
+
+    struct Line {
+        Line() : os(&buf), busy(false) {}
+        void reset() { buf.reset(); os.clear(); }
+        const char * str() { return buf.str(); }
+        Buf buf;
+        std::ostream os;
+        bool busy;
+    };
+
+    static Line & line()
+    {
+        thread_local Line mine;
+        return mine;
+    }
+
+    DebugLevel _level;
+    Line & _line;
+    std::unique_ptr<std::ostringstream> _spare;
+};
+
+//! 'message' is only evaluated if 'level' is enabled
 #define DebugMsg(level, message)                                \
     do {                                                        \
-        if ((level) <= g_debug_level) {                         \
-            stringstream SSTR, SLOC;                            \
-            SSTR << message;                                    \
-            SLOC << __SHORT_FILE__ << ":" << __LINE__;          \
-            DebugFunc(level, SSTR.str(), SLOC.str());           \
+        if (DebugEnabled(level)) {                              \
+            DebugLog DLOG(level);                               \
+            DLOG.stream() << message;                           \
+            DLOG.emit(__SHORT_FILE__, __LINE__);                \
         }                                                       \
     } while (0)
 
 #define MSG(msg)   DebugMsg(LEVEL_ALL, msg)
 #define ERROR(msg) DebugMsg(LEVEL_ERROR, msg)
 #define WARN(msg)  DebugMsg(LEVEL_WARN, msg)
+#if DEBUG_MAX_LEVEL >= 3
 #define INFO(msg)  DebugMsg(LEVEL_INFO, msg)
-#ifdef NDEBUG
-#define INFO2(msg) do {} while (0)
 #else
+#define INFO(msg)  do {} while (0)
+#endif
+#if DEBUG_MAX_LEVEL >= 4
 #define INFO2(msg) DebugMsg(LEVEL_INFO2, msg)
+#else
+#define INFO2(msg) do {} while (0)
 #endif
 
 #define THROWERROR(msg) do {                                    \
@@ -72,14 +284,12 @@ constexpr cstr past_last_slash(cstr str)
         throw std::runtime_error(SSTR.str());                   \
     } while (0)
 
-#ifndef NDEBUG
-std::map<string, uint64_t> & g_debug_events();
-//! count debug events
-#define DEBUG_EVENT(EVENT_NAME) g_debug_events()[EVENT_NAME]++
-//#define DEBUG_EVENT(EVENT_NAME) do {} while (0)
-#else
-#define DEBUG_EVENT(EVENT_NAME) do {} while (0)
-#endif
+//! count debug events in the Counter registry, EVENT_NAME must be a literal
+#define DEBUG_EVENT(EVENT_NAME)                                         \
+    do {                                                                \
+        static Counter COUNTER(EVENT_NAME);                             \
+        COUNTER.add();                                                  \
+    } while (0)
 
 //! utility function for putting maps of things to streams
 #include <map>
@@ -0,0 +1,340 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// FID to spectrum processing: apodization, zero fill, ft, phase
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Linux: g++ -std=c++11 -O2 -pthread -DFIDPROC_MAIN -o fidproc fidproc.cpp procdata.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+//
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "fidproc.hpp"
+#include "parallel.hpp"
+#include "ldrschema.hpp"
+
+// //////////////////////////////////////////////////////////
+// FftPlan
+
+FftPlan::FftPlan(size_t n)
+  : _n(n)
+{
+  if (n < 2 || (n & (n - 1))) {
+    stringstream str;
+    str << "FftPlan: size " << n << " is not a power of 2";
+    throw std::invalid_argument(str.str());
+  }
+  int bits = 0;
+  while (((size_t)1 << bits) < n)
+    bits++;
+  _bitrev.resize(n);
+  for (size_t ii = 0; ii < n; ii++) {
+    uint32_t rr = 0;
+    for (int bb = 0; bb < bits; bb++)
+      rr |= ((ii >> bb) & 1) << (bits - 1 - bb);
+    _bitrev[ii] = rr;
+  }
+  _twiddle.resize(n / 2);
+  for (size_t kk = 0; kk < n / 2; kk++)
+    _twiddle[kk] = std::polar(1.0, -2 * M_PI * (double)kk / (double)n);
+}
+
+size_t
+FftPlan::size() const
+{
+  return _n;
+}
+
+void
+FftPlan::forward(cplx * data) const
+{
+  for (size_t ii = 0; ii < _n; ii++)
+    if (ii < _bitrev[ii])
+      std::swap(data[ii], data[_bitrev[ii]]);
+
+  // complex<double> is layout compatible with double[2], doing the
+  // arithmetic by hand avoids the nan/inf checks in operator*
+  double * d = reinterpret_cast<double *>(data);
+  const double * tw = reinterpret_cast<const double *>(&_twiddle[0]);
+  for (size_t len = 2; len <= _n; len <<= 1) {
+    size_t half = len / 2;
+    size_t step = _n / len;
+    for (size_t ii = 0; ii < _n; ii += len) {
+      double * a = d + 2 * ii;
+      double * b = d + 2 * (ii + half);
+      for (size_t jj = 0; jj < half; jj++) {
+        double wr = tw[2 * jj * step], wi = tw[2 * jj * step + 1];
+        double vr = b[2 * jj] * wr - b[2 * jj + 1] * wi;
+        double vi = b[2 * jj] * wi + b[2 * jj + 1] * wr;
+        double ur = a[2 * jj], ui = a[2 * jj + 1];
+        a[2 * jj] = ur + vr;
+        a[2 * jj + 1] = ui + vi;
+        b[2 * jj] = ur - vr;
+        b[2 * jj + 1] = ui - vi;
+      }
+    }
+  }
+}
+
+// //////////////////////////////////////////////////////////
+// ProcParams
+
+// just what processing uses, an odd value elsewhere in procs or acqus
+// doesn't stop it
+struct FidProcs
+{
+  int SI = 0, TDeff = 0, WDW = 0;
+  double LB = 0, GB = 0, SSB = 0, PHC0 = 0, PHC1 = 0;
+};
+
+LDR_SCHEMA_BEGIN(FidProcs, "procs")
+  LDR_FIELD(SI), LDR_FIELD(TDeff), LDR_FIELD(WDW),
+  LDR_FIELD(LB), LDR_FIELD(GB), LDR_FIELD(SSB), LDR_FIELD(PHC0), LDR_FIELD(PHC1),
+LDR_SCHEMA_END()
+
+struct FidAcqus
+{
+  double SW_h = 0;
+  int AQ_mod = 0;
+};
+
+LDR_SCHEMA_BEGIN(FidAcqus, "acqus")
+  LDR_FIELD(SW_h), LDR_FIELD(AQ_mod),
+LDR_SCHEMA_END()
+
+ProcParams::ProcParams()
+  : wdw(WDW_NONE), lb(0), gb(0), ssb(0), si(0), tdeff(0),
+    phc0(0), phc1(0), sw_h(1), aq_mod(AQ_MOD_DQD), grpdly(0)
+{
+}
+
+ProcParams::ProcParams(const Ldrset & procs, const Ldrset & acqus)
+{
+  FidProcs pp;
+  FidAcqus aa;
+  if (!ldr_schema_load(procs, pp).has("SI"))
+    throw std::out_of_range("ProcParams: no SI in procs");
+  LdrFound<FidAcqus> found = ldr_schema_load(acqus, aa);
+  if (!found.has("SW_h"))
+    throw std::out_of_range("ProcParams: no SW_h in acqus");
+  wdw = pp.WDW;
+  lb = pp.LB;
+  gb = pp.GB;
+  ssb = pp.SSB;
+  si = (size_t)pp.SI;
+  tdeff = (size_t)pp.TDeff / 2;
+  phc0 = pp.PHC0;
+  phc1 = pp.PHC1;
+  sw_h = aa.SW_h;
+  aq_mod = found.has("AQ_mod") ? aa.AQ_mod : (int)AQ_MOD_DQD;
+  grpdly = 0;
+}
+
+// //////////////////////////////////////////////////////////
+// FidProcessor
+
+FidProcessor::FidProcessor(const ProcParams & params)
+  : _p(params), _plan(params.si)
+{
+  if (_p.aq_mod != AQ_MOD_QSIM && _p.aq_mod != AQ_MOD_DQD) {
+    stringstream str;
+    str << "FidProcessor: unsupported AQ_mod=" << _p.aq_mod << ", only complex (qsim, DQD) data";
+    throw std::invalid_argument(str.str());
+  }
+  // phase correction & group delay ramp, indexed in TopSpin's order: point
+  // ii is frequency bin si/2 - ii, so the carrier lands on point si/2.  the
+  // pk phase is -(PHC0 + PHC1 * ii / SI) degrees, the PHC1 ramp running
+  // from the left (high frequency) end, as testfidproc.sh checks
+  const size_t si = _p.si;
+  _phase.resize(si);
+  for (size_t ii = 0; ii < si; ii++) {
+    double ph = -(_p.phc0 + _p.phc1 * (double)ii / (double)si) * M_PI / 180;
+    double bin = (double)(si / 2) - (double)ii;
+    ph += 2 * M_PI * _p.grpdly * bin / (double)si;
+    _phase[ii] = std::polar(1.0, ph);
+  }
+}
+
+FidProcessor::FidProcessor(const Ldrset & procs, const Ldrset & acqus)
+  : FidProcessor(ProcParams(procs, acqus))
+{
+}
+
+const ProcParams &
+FidProcessor::params() const
+{
+  return _p;
+}
+
+size_t
+FidProcessor::size() const
+{
+  return _p.si;
+}
+
+std::vector<double>
+FidProcessor::window(size_t td) const
+{
+  std::vector<double> w(td, 1.0);
+  const double aq = td / _p.sw_h;
+  switch (_p.wdw) {
+  case WDW_NONE:
+    break;
+  case WDW_EM:
+    for (size_t nn = 0; nn < td; nn++)
+      w[nn] = std::exp(-M_PI * _p.lb * nn / _p.sw_h);
+    break;
+  case WDW_GM: {
+    double a = M_PI * _p.lb;
+    double b = _p.gb > 0 ? -a / (2 * _p.gb * aq) : 0;
+    for (size_t nn = 0; nn < td; nn++) {
+      double t = nn / _p.sw_h;
+      w[nn] = std::exp(-a * t - b * t * t);
+    }
+    break;
+  }
+  case WDW_SINE:
+  case WDW_QSINE: {
+    double phi = _p.ssb >= 2 ? M_PI / _p.ssb : 0;
+    for (size_t nn = 0; nn < td; nn++) {
+      w[nn] = std::sin(phi + (M_PI - phi) * nn / td);
+      if (_p.wdw == WDW_QSINE)
+        w[nn] *= w[nn];
+    }
+    break;
+  }
+  default: {
+    stringstream str;
+    str << "FidProcessor: unsupported WDW=" << _p.wdw;
+    throw std::invalid_argument(str.str());
+  }
+  }
+  return w;
+}
+
+void
+FidProcessor::processRow(const cplx * fid, const std::vector<double> & window, cplx * spec) const
+{
+  const size_t si = _p.si;
+  const size_t n = std::min(window.size(), si);
+  // one work buffer per thread, reused from row to row
+  static thread_local std::vector<cplx> buf;
+  buf.assign(si, cplx(0, 0));
+
+  // apodize & zero fill
+  const double * f = reinterpret_cast<const double *>(fid);
+  double * b = reinterpret_cast<double *>(&buf[0]);
+  for (size_t ii = 0; ii < n; ii++) {
+    b[2 * ii] = f[2 * ii] * window[ii];
+    b[2 * ii + 1] = f[2 * ii + 1] * window[ii];
+  }
+
+  _plan.forward(&buf[0]);
+
+  // fftshift, reverse into TopSpin's order and phase in one pass
+  const double * ph = reinterpret_cast<const double *>(&_phase[0]);
+  double * s = reinterpret_cast<double *>(spec);
+  for (size_t ii = 0; ii < si; ii++) {
+    size_t src = (si / 2 - ii) & (si - 1);
+    double xr = b[2 * src], xi = b[2 * src + 1];
+    s[2 * ii] = xr * ph[2 * ii] - xi * ph[2 * ii + 1];
+    s[2 * ii + 1] = xr * ph[2 * ii + 1] + xi * ph[2 * ii];
+  }
+}
+
+void
+FidProcessor::process(const cplx * fids, size_t td, size_t rows, cplx * spec, unsigned nthreads) const
+{
+  size_t used = _p.tdeff ? std::min(_p.tdeff, td) : td;
+  std::vector<double> w = window(used);
+  parallel_for(rows, [&](size_t rr) {
+      processRow(fids + rr * td, w, spec + rr * _p.si);
+    }, nthreads);
+}
+
+#ifdef FIDPROC_MAIN
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "procdata.hpp"
+#include "rawdata.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_WARN);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  std::cerr << location << ":" << str << "\n";
+}
+
+// rms of ours * scale - ref relative to ref, for the best real 'scale'
+// (1r/1i are scaled by TopSpin, and NC_proc only approximately undoes it)
+static double
+residual(const std::vector<cplx> & ours, const std::vector<cplx> & ref)
+{
+  double cross = 0, norm = 0, refnorm = 0;
+  for (size_t ii = 0; ii < ours.size(); ii++) {
+    cross += (ours[ii] * std::conj(ref[ii])).real();
+    norm += std::norm(ours[ii]);
+    refnorm += std::norm(ref[ii]);
+  }
+  double scale = norm > 0 ? cross / norm : 0;
+  double diff = 0;
+  for (size_t ii = 0; ii < ours.size(); ii++)
+    diff += std::norm(ours[ii] * scale - ref[ii]);
+  return refnorm > 0 ? std::sqrt(diff / refnorm) : 0;
+}
+
+// process an experiment's fid with pdata/procno/procs and compare it with
+// the 1r/1i TopSpin wrote there
+int main(int argc, char *argv[])
+{
+  double tol = 1e-2;
+  int arg = 1;
+  if (arg + 1 < argc && !strcmp(argv[arg], "-t")) {
+    tol = atof(argv[arg + 1]);
+    arg += 2;
+  }
+  if (argc - arg < 1 || argc - arg > 2) {
+    std::cerr << "usage: " << argv[0] << " [-t tolerance] ../path/to/expno [procno]\n";
+    return 1;
+  }
+  string exppath = argv[arg];
+  int procno = argc - arg > 1 ? atoi(argv[arg + 1]) : 1;
+
+  try {
+    std::stringstream procpath;
+    procpath << exppath << "/pdata/" << procno;
+    ProcData pdata(procpath.str());
+    if (pdata.ndim() != 1)
+      throw std::invalid_argument(procpath.str() + " isn't 1D");
+    RawData raw(exppath, GRPDLY_SHIFT);
+    ProcParams params(pdata.procs(), raw.acqus());
+    params.grpdly = raw.residualDelay();
+
+    const size_t si = pdata.size(0);
+    std::vector<double> re(si), im(si);
+    pdata.read("1r", re.data());
+    pdata.read("1i", im.data());
+    std::vector<cplx> ref(si);
+    for (size_t ii = 0; ii < si; ii++)
+      ref[ii] = cplx(re[ii], im[ii]);
+    std::vector<cplx> fid(raw.points());
+    raw.readRows(0, 1, fid.data());
+
+    FidProcessor proc(params);
+    if (proc.size() != si)
+      throw std::invalid_argument("SI of procs and 1r differ");
+    std::vector<cplx> spec(si);
+    proc.process(fid.data(), raw.points(), 1, spec.data());
+    double err = residual(spec, ref);
+    printf("%s: SI %zu WDW %d PHC0 %g PHC1 %g, relative rms difference %g\n",
+           procpath.str().c_str(), si, params.wdw, params.phc0, params.phc1, err);
+    return err <= tol ? 0 : 2;
+  }
+  catch (const std::exception & ex) {
+    std::cerr << "failed: " << ex.what() << "\n";
+    return -1;
+  }
+}
+#endif // FIDPROC_MAIN
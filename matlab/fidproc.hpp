@@ -0,0 +1,104 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// FID to spectrum processing: apodization, zero fill, ft, phase
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// reproduces TopSpin's ef/gm/sinm/qsin, zf, ft and pk along the direct
+// dimension using the procs & acqus parameters.  the spectrum comes out in
+// TopSpin's order, highest frequency first with the carrier on point SI/2,
+// like 1r/1i (but unscaled).  only complex data (AQ_mod qsim or DQD) is
+// transformed, like xf2 a ser is done row by row whatever its FnMODE.
+// build fidproc.cpp with -DFIDPROC_MAIN to check the result against an
+// experiment's 1r/1i (see testfidproc.sh).
+//
+#ifndef FIDPROC_HPP
+#define FIDPROC_HPP
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+#include "jcampdx.hpp"
+
+typedef std::complex<double> cplx;
+
+//! precomputed in-place radix-2 complex FFT of a fixed size
+class FftPlan
+{
+public:
+  FftPlan(size_t n);
+  size_t size() const;
+  //! forward transform, X[k] = sum x[n] exp(-2 pi i n k / N), unnormalized
+  void forward(cplx * data) const;
+
+private:
+  size_t _n;
+  std::vector<cplx> _twiddle;
+  std::vector<uint32_t> _bitrev;
+};
+
+//! direct dimension acquisition modes, numbered like AQ_mod
+enum aq_mod_type {
+  AQ_MOD_QF = 0,     //!< real
+  AQ_MOD_QSIM = 1,
+  AQ_MOD_QSEQ = 2,   //!< real, sequential
+  AQ_MOD_DQD = 3,
+};
+
+//! window functions, numbered like WDW
+enum wdw_type {
+  WDW_NONE = 0,
+  WDW_EM = 1,
+  WDW_GM = 2,
+  WDW_SINE = 3,
+  WDW_QSINE = 4,
+};
+
+struct ProcParams
+{
+  ProcParams();
+  //! take WDW, LB, GB, SSB, SI, TDeff, PHC0, PHC1 from procs and SW_h, AQ_mod from acqus
+  ProcParams(const Ldrset & procs, const Ldrset & acqus);
+
+  int wdw;
+  double lb;           //!< Hz
+  double gb;           //!< fraction of AQ
+  double ssb;
+  size_t si;           //!< spectrum size, complex points
+  size_t tdeff;        //!< complex points of the fid used, 0 = all
+  double phc0;         //!< degrees
+  double phc1;         //!< degrees
+  double sw_h;         //!< Hz
+  int aq_mod;          //!< DQD if acqus has none
+  double grpdly;       //!< group delay (points) left in the fid, removed by a phase ramp
+};
+
+class FidProcessor
+{
+public:
+  //! throws std::invalid_argument for real (qf, qseq) data
+  FidProcessor(const ProcParams & params);
+  FidProcessor(const Ldrset & procs, const Ldrset & acqus);
+
+  const ProcParams & params() const;
+  //! number of points in each output spectrum, SI
+  size_t size() const;
+
+  //! process 'rows' fids of 'td' complex points (one after the other) into 'spec'
+  //
+  // 'spec' is rows x size().  rows are processed in parallel on 'nthreads'
+  // threads (0 = all).
+  void process(const cplx * fids, size_t td, size_t rows, cplx * spec, unsigned nthreads = 0) const;
+
+  //! the window for a fid of 'td' complex points
+  std::vector<double> window(size_t td) const;
+
+private:
+  void processRow(const cplx * fid, const std::vector<double> & window, cplx * spec) const;
+
+  ProcParams _p;
+  FftPlan _plan;
+  std::vector<cplx> _phase;
+};
+
+#endif // FIDPROC_HPP
@@ -0,0 +1,232 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// follow a ser file while it is being acquired
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Linux: g++ -std=c++11 -O2 -pthread -DFOLLOW_MAIN -o follow follow.cpp fidproc.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+//
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "follow.hpp"
+#include "parallel.hpp"
+
+// how long to sleep between checks when nothing tells us the file changed
+static const int g_follow_poll_ms = 250;
+
+SerFollower::SerFollower(const string & exppath, grpdly_mode mode, size_t chunkrows)
+  : _exppath(exppath),
+    _serfile(exppath + "/ser"),
+    _raw(Ldrset(exppath + "/acqus"), exppath + "/ser", mode),
+    _chunkrows(std::max(chunkrows, (size_t)1)),
+    _expected(0),
+    _done(0),
+    _stop(false)
+{
+  struct stat st;
+  for (int dim = 2; dim <= 8; dim++) {
+    std::stringstream name;
+    name << exppath << "/acqu" << dim << "s";
+    if (stat(name.str().c_str(), &st))
+      break;
+    Ldrset acqu(name.str());
+    _expected = (_expected ? _expected : 1) * (size_t)acqu.getDouble("TD");
+  }
+}
+
+const RawData &
+SerFollower::raw() const
+{
+  return _raw;
+}
+
+size_t
+SerFollower::expectedRows() const
+{
+  return _expected;
+}
+
+size_t
+SerFollower::rowsDone() const
+{
+  return _done;
+}
+
+size_t
+SerFollower::poll(const callback & cb, unsigned nthreads)
+{
+  struct stat st;
+  if (stat(_serfile.c_str(), &st))
+    return 0;
+  const size_t filesize = (size_t)st.st_size;
+  const size_t avail = _raw.rowsIn(filesize);
+  if (avail <= _done)
+    return 0;
+
+  std::unique_ptr<FILE, int (*)(FILE *)> fp(fopen(_serfile.c_str(), "rb"), fclose);
+  if (!fp)
+    throw std::runtime_error("SerFollower: unable to open " + _serfile);
+
+  const size_t rowbytes = _raw.rowBytes();
+  const size_t points = _raw.points();
+  _inbuf.resize(_chunkrows * rowbytes);
+  _outbuf.resize(_chunkrows * _raw.tdPoints());
+
+  size_t total = 0;
+  while (_done < avail && !_stop) {
+    size_t count = std::min(_chunkrows, avail - _done);
+    // the last row on disk may not have its padding yet
+    size_t bytes = std::min(count * rowbytes, filesize - _done * rowbytes);
+    bru_fseek(fp.get(), (uint64_t)_done * rowbytes, _serfile);
+    bru_fread(&_inbuf[0], bytes, fp.get(), _serfile);
+    parallel_for(count, [&](size_t rr) {
+        _raw.convertRow(&_inbuf[rr * rowbytes], &_outbuf[rr * points]);
+      }, nthreads);
+    cb(_done, count, &_outbuf[0]);
+    _done += count;
+    total += count;
+  }
+  return total;
+}
+
+size_t
+SerFollower::follow(const callback & cb, double idle, unsigned nthreads)
+{
+#if defined(__linux__)
+  // any change in the directory wakes us, including ser being created
+  int ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (ifd >= 0 && inotify_add_watch(ifd, _exppath.c_str(),
+                                    IN_MODIFY | IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    WARN("SerFollower: can't watch " << _exppath << ", polling instead");
+    close(ifd);
+    ifd = -1;
+  }
+  std::unique_ptr<int, void (*)(int *)> guard(&ifd, [](int * fd) { if (*fd >= 0) close(*fd); });
+#endif
+
+  typedef std::chrono::steady_clock clock;
+  clock::time_point last = clock::now();
+  size_t total = 0;
+  while (!_stop) {
+    size_t nn = poll(cb, nthreads);
+    total += nn;
+    if (nn)
+      last = clock::now();
+    if (_expected && _done >= _expected)
+      break;
+    if (idle > 0 && std::chrono::duration<double>(clock::now() - last).count() > idle)
+      break;
+
+#if defined(__linux__)
+    if (ifd >= 0) {
+      struct pollfd pfd = { ifd, POLLIN, 0 };
+      if (::poll(&pfd, 1, g_follow_poll_ms) > 0) {
+        char events[4096];
+        while (read(ifd, events, sizeof(events)) > 0)
+          ;
+      }
+      continue;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(g_follow_poll_ms));
+  }
+  _stop = false;
+  return total;
+}
+
+void
+SerFollower::stop()
+{
+  _stop = true;
+}
+
+#ifdef FOLLOW_MAIN
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "fidproc.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_WARN);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  std::cerr << location << ":" << str << "\n";
+}
+
+// print the snr and peak position of every row as it is acquired
+int main(int argc, char *argv[])
+{
+  if (argc < 2 || argc > 4) {
+    std::cerr << "usage: " << argv[0] << " ../path/to/expno [procno [idle-seconds]]\n";
+    return 1;
+  }
+  string exppath = argv[1];
+  int procno = argc > 2 ? atoi(argv[2]) : 1;
+  double idle = argc > 3 ? atof(argv[3]) : 0;
+
+  try {
+    SerFollower fol(exppath, GRPDLY_SHIFT);
+    std::stringstream procfile;
+    procfile << exppath << "/pdata/" << procno << "/procs";
+    struct stat st;
+    ProcParams params;
+    if (!stat(procfile.str().c_str(), &st)) {
+      Ldrset procs(procfile.str());
+      params = ProcParams(procs, fol.raw().acqus());
+    }
+    else {
+      params.sw_h = fol.raw().acqus().getDouble("SW_h");
+      for (params.si = 2; params.si < fol.raw().points(); params.si *= 2)
+        ;
+    }
+    params.grpdly = fol.raw().residualDelay();
+    FidProcessor proc(params);
+    const size_t si = proc.size();
+    std::vector<cplx> spec;
+    double peak0 = 0;
+
+    std::cout << "# row snr peak_hz drift_hz\n";
+    fol.follow([&](size_t first, size_t count, const cplx * rows) {
+        spec.resize(count * si);
+        proc.process(rows, fol.raw().points(), count, &spec[0]);
+        for (size_t rr = 0; rr < count; rr++) {
+          const cplx * s = &spec[rr * si];
+          size_t imax = 0;
+          for (size_t ii = 1; ii < si; ii++)
+            if (std::abs(s[ii]) > std::abs(s[imax]))
+              imax = ii;
+          // noise from the outer 1/16th at each end of the spectrum
+          double sum = 0, sum2 = 0;
+          size_t nn = 0;
+          for (size_t ii = 0; ii < si; ii++)
+            if (ii < si / 16 || ii >= si - si / 16) {
+              sum += s[ii].real();
+              sum2 += s[ii].real() * s[ii].real();
+              nn++;
+            }
+          double mean = nn ? sum / nn : 0;
+          double sd = nn ? std::sqrt(std::max(sum2 / nn - mean * mean, 0.0)) : 0;
+          double hz = ((double)(si / 2) - (double)imax) * params.sw_h / si;
+          if (first + rr == 0)
+            peak0 = hz;
+          printf("%zu %g %g %g\n", first + rr, sd > 0 ? std::abs(s[imax]) / sd : 0, hz, hz - peak0);
+        }
+        fflush(stdout);
+      }, idle);
+  }
+  catch (const std::exception & ex) {
+    std::cerr << "failed: " << ex.what() << "\n";
+    return -1;
+  }
+  return 0;
+}
+#endif
@@ -0,0 +1,60 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// follow a ser file while it is being acquired
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// acqus is parsed once, then every time the ser grows only the newly
+// completed rows are read and handed to a callback, a chunk at a time.
+// memory use is bounded by the chunk size no matter how long the
+// acquisition runs.  on linux the experiment directory is watched with
+// inotify, elsewhere the file size is polled.
+//
+#ifndef FOLLOW_HPP
+#define FOLLOW_HPP
+
+#include <atomic>
+#include <complex>
+#include <functional>
+#include <string>
+#include <vector>
+#include "rawdata.hpp"
+
+class SerFollower
+{
+public:
+  //! rows [first, first+count), each RawData::points() long
+  typedef std::function<void(size_t first, size_t count, const std::complex<double> * rows)> callback;
+
+  //! follow exppath/ser (which need not exist yet), at most 'chunkrows' rows per callback
+  SerFollower(const string & exppath, grpdly_mode mode = GRPDLY_SHIFT, size_t chunkrows = 64);
+
+  const RawData & raw() const;
+  //! rows in the finished acquisition, from TD in acqu2s..acquNs, 0 if unknown
+  size_t expectedRows() const;
+  //! rows handed to the callback so far
+  size_t rowsDone() const;
+
+  //! process whatever new complete rows are in the file, return how many
+  size_t poll(const callback & cb, unsigned nthreads = 0);
+
+  //! process rows as they land until expectedRows() are done, stop() is
+  //! called, or nothing arrives for 'idle' seconds (0 = wait forever)
+  size_t follow(const callback & cb, double idle = 0, unsigned nthreads = 0);
+
+  //! make follow() return, may be called from another thread or a callback
+  void stop();
+
+private:
+  string _exppath;
+  string _serfile;
+  RawData _raw;
+  size_t _chunkrows;
+  size_t _expected;
+  size_t _done;
+  std::atomic<bool> _stop;
+  std::vector<uint8_t> _inbuf;
+  std::vector<std::complex<double> > _outbuf;
+};
+
+#endif // FOLLOW_HPP
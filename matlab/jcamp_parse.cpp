@@ -87,7 +87,7 @@
 #include "jcamp_scan.hpp"
 #include "jcampdx.hpp"
 
-static void jcamp_yyerror(_YYLTYPE * yylloc, Ldrset & jdx, yyscan_t scanner, const char *s);
+static void jcamp_yyerror(_YYLTYPE * yylloc, JcampParse & jdx, yyscan_t scanner, const char *s);
 #define YYLLOC_DEFAULT(Current, Rhs, NN) FILELOC_YYLLOC_DEFAULT(jdx, Current, Rhs, NN)
 
 using ppg::Loc_Error;
@@ -176,7 +176,7 @@ struct YYLTYPE
 
 
 
-int jcamp_yyparse (Ldrset & jdx, yyscan_t scanner);
+int jcamp_yyparse (JcampParse & jdx, yyscan_t scanner);
 
 #endif /* !YY_JCAMP_YY_HOME_TESCH_SRC_SPINDROPSSDL_BUILD_JCAMP_PARSE_HPP_INCLUDED  */
 
@@ -738,7 +738,7 @@ do {                                                                      \
 `----------------------------------------*/
 
 static void
-yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, Ldrset & jdx, yyscan_t scanner)
+yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, JcampParse & jdx, yyscan_t scanner)
 {
   FILE *yyo = yyoutput;
   YYUSE (yyo);
@@ -760,7 +760,7 @@ yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvalue
 `--------------------------------*/
 
 static void
-yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, Ldrset & jdx, yyscan_t scanner)
+yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, JcampParse & jdx, yyscan_t scanner)
 {
   YYFPRINTF (yyoutput, "%s %s (",
              yytype < YYNTOKENS ? "token" : "nterm", yytname[yytype]);
@@ -800,7 +800,7 @@ do {                                                            \
 `------------------------------------------------*/
 
 static void
-yy_reduce_print (yytype_int16 *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp, int yyrule, Ldrset & jdx, yyscan_t scanner)
+yy_reduce_print (yytype_int16 *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp, int yyrule, JcampParse & jdx, yyscan_t scanner)
 {
   unsigned long int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
@@ -1080,7 +1080,7 @@ yysyntax_error (YYSIZE_T *yymsg_alloc, char **yymsg,
 `-----------------------------------------------*/
 
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, YYLTYPE *yylocationp, Ldrset & jdx, yyscan_t scanner)
+yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, YYLTYPE *yylocationp, JcampParse & jdx, yyscan_t scanner)
 {
   YYUSE (yyvaluep);
   YYUSE (yylocationp);
@@ -1114,7 +1114,7 @@ yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, YYLTYPE *yylocatio
 `----------*/
 
 int
-yyparse (Ldrset & jdx, yyscan_t scanner)
+yyparse (JcampParse & jdx, yyscan_t scanner)
 {
 /* The lookahead symbol.  */
 int yychar;
@@ -1389,7 +1389,7 @@ yyreduce:
     {
         case 2:
 #line 60 "src/jcamp.y" /* yacc.c:1646  */
-    { jdx.jcamp_topnode = (yyval.block) = (yyvsp[0].block); }
+    { jdx.topnode = (yyval.block) = (yyvsp[0].block); }
 #line 1394 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
@@ -1410,6 +1410,7 @@ yyreduce:
     {
           (yyval.block) = (yyvsp[-1].block);
           (yyval.block)->addLdr("TITLE", *(yyvsp[-2].ldr));
+          delete (yyvsp[-2].ldr);
         }
 #line 1415 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
@@ -1425,7 +1426,7 @@ yyreduce:
 
   case 7:
 #line 82 "src/jcamp.y" /* yacc.c:1646  */
-    { (yyval.block) = (yyvsp[-1].block); (yyval.block)->addLdr(*(yyvsp[0].ldr)); }
+    { (yyval.block) = (yyvsp[-1].block); (yyval.block)->addLdr((yyvsp[0].ldr)); }
 #line 1430 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
@@ -1437,7 +1438,7 @@ yyreduce:
 
   case 9:
 #line 84 "src/jcamp.y" /* yacc.c:1646  */
-    { (yyval.block) = new Ldrset(); (yyval.block)->addLdr(*(yyvsp[0].ldr)); }
+    { (yyval.block) = new Ldrset(); (yyval.block)->addLdr((yyvsp[0].ldr)); }
 #line 1442 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
@@ -1453,6 +1454,8 @@ yyreduce:
           (yyval.ldr) = (yyvsp[0].ldr);
           (yyval.ldr)->setLabel((yyvsp[-2].str));
           (yyval.ldr)->setShape((yyvsp[-1].str));
+          free((yyvsp[-2].str));
+          free((yyvsp[-1].str));
         }
 #line 1458 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
@@ -1463,10 +1466,13 @@ yyreduce:
           if ((yyvsp[0].ldr)->size()) {
             (yyval.ldr) = (yyvsp[0].ldr);
             (yyval.ldr)->setShape(*(yyvsp[-1].ldr));
+            delete (yyvsp[-1].ldr);
           } else {
             (yyval.ldr) = (yyvsp[-1].ldr);
+            delete (yyvsp[0].ldr);
           }
           (yyval.ldr)->setLabel((yyvsp[-2].str));
+          free((yyvsp[-2].str));
         }
 #line 1472 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
@@ -1476,6 +1482,7 @@ yyreduce:
     {
           (yyval.ldr) = (yyvsp[0].ldr);
           (yyval.ldr)->setLabel((yyvsp[-1].str));
+          free((yyvsp[-1].str));
         }
 #line 1481 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
@@ -1485,6 +1492,8 @@ yyreduce:
     {
           (yyval.ldr) = new Ldr(RECORD_TEXT, (yyvsp[0].str));
           (yyval.ldr)->setLabel((yyvsp[-1].str));
+          free((yyvsp[-1].str));
+          free((yyvsp[0].str));
         }
 #line 1490 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
@@ -1497,13 +1506,13 @@ yyreduce:
 
   case 16:
 #line 122 "src/jcamp.y" /* yacc.c:1646  */
-    { (yyval.ldr) = (yyvsp[-1].ldr); (yyval.ldr)->appendStr((yyvsp[0].str)); }
+    { (yyval.ldr) = (yyvsp[-1].ldr); (yyval.ldr)->appendStr((yyvsp[0].str)); free((yyvsp[0].str)); }
 #line 1502 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
   case 17:
 #line 123 "src/jcamp.y" /* yacc.c:1646  */
-    { (yyval.ldr) = (yyvsp[-1].ldr); (yyval.ldr)->appendStr((yyvsp[0].str), true); }
+    { (yyval.ldr) = (yyvsp[-1].ldr); (yyval.ldr)->appendStr((yyvsp[0].str), true); free((yyvsp[0].str)); }
 #line 1508 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
@@ -1539,19 +1548,19 @@ yyreduce:
 
   case 23:
 #line 135 "src/jcamp.y" /* yacc.c:1646  */
-    { (yyval.ldr) = new Ldr(RECORD_STRING, (yyvsp[0].str)); }
+    { (yyval.ldr) = new Ldr(RECORD_STRING, (yyvsp[0].str)); free((yyvsp[0].str)); }
 #line 1544 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
   case 24:
 #line 136 "src/jcamp.y" /* yacc.c:1646  */
-    { (yyval.ldr) = new Ldr(RECORD_QSTRING, (yyvsp[0].str)); }
+    { (yyval.ldr) = new Ldr(RECORD_QSTRING, (yyvsp[0].str)); free((yyvsp[0].str)); }
 #line 1550 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
   case 25:
 #line 137 "src/jcamp.y" /* yacc.c:1646  */
-    { (yyval.ldr) = new Ldr(RECORD_STRING, (yyvsp[0].str)); }
+    { (yyval.ldr) = new Ldr(RECORD_STRING, (yyvsp[0].str)); free((yyvsp[0].str)); }
 #line 1556 "/home/tesch/src/SpinDropsSDL/Build/jcamp_parse.cpp" /* yacc.c:1646  */
     break;
 
@@ -1794,7 +1803,7 @@ yyreturn:
 #line 140 "src/jcamp.y" /* yacc.c:1906  */
 
 
-void jcamp_yyerror(_YYLTYPE * yylloc, Ldrset & , yyscan_t , const char *s)
+void jcamp_yyerror(_YYLTYPE * yylloc, JcampParse & , yyscan_t , const char *s)
 {
   stringstream errstr;
   errstr << "parse: " << yylloc->filename
@@ -93,6 +93,6 @@ struct YYLTYPE
 
 
 
-int jcamp_yyparse (Ldrset & jdx, yyscan_t scanner);
+int jcamp_yyparse (JcampParse & jdx, yyscan_t scanner);
 
 #endif /* !YY_JCAMP_YY_HOME_TESCH_SRC_SPINDROPSSDL_BUILD_JCAMP_PARSE_HPP_INCLUDED  */
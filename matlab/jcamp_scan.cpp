@@ -7,6 +7,7 @@ typedef void* yyscan_t;
 #include "jcampdx.hpp"
 #include "jcamp_parse.hpp"
 #include "FileLoc.hpp"
+#include "counters.hpp"
 
 #ifndef jcamp_yyset_column
 // bug in flex 2.5.35 - this isn't prototyped 
@@ -22,7 +23,7 @@ extern int jcamp_yyget_column (yyscan_t yyscanner);
 #endif
 
 #define YY_DECL int jcamp_yylex \
-    (YYSTYPE * yylval_param, YYLTYPE * yylloc_param , Ldrset & jdx, yyscan_t yyscanner)
+    (YYSTYPE * yylval_param, YYLTYPE * yylloc_param , JcampParse & jdx, yyscan_t yyscanner)
 YY_DECL;
 
 #line 28 "/home/tesch/src/SpinDropsSDL/Build/jcamp_scan.cpp"
@@ -859,7 +860,13 @@ static const flex_int32_t yy_rule_can_match_eol[21] =
     return v;
   }
 
+  // every rule match, whitespace & comments included
+  static Counter c_scan_bytes("jcamp.scan.bytes");
+  static Counter c_scan_matches("jcamp.scan.matches");
+
 #define YY_USER_ACTION do {                                             \
+    c_scan_bytes.add(yyleng);                                           \
+    c_scan_matches.add();                                               \
     yylloc->first_line = yylloc->last_line;                             \
     yylloc->first_column = yylloc->last_column;                         \
     yylloc->rawtext = yyget_text(yyscanner);                            \
@@ -872,7 +879,7 @@ static const flex_int32_t yy_rule_can_match_eol[21] =
         yylloc->last_column++;                                          \
       }                                                                 \
     }                                                                   \
-    yylloc->filename = jdx._curfilename;                                \
+    yylloc->filename = jdx.filename;                                \
     /*INFO(">" << yytext << "<");*/                                     \
   } while(0);
 
@@ -26,7 +26,7 @@ extern int jcamp_yyget_column (yyscan_t yyscanner);
 #endif
 
 #define YY_DECL int jcamp_yylex \
-    (YYSTYPE * yylval_param, YYLTYPE * yylloc_param , Ldrset & jdx, yyscan_t yyscanner)
+    (YYSTYPE * yylval_param, YYLTYPE * yylloc_param , JcampParse & jdx, yyscan_t yyscanner)
 YY_DECL;
 
 #line 32 "/home/tesch/src/SpinDropsSDL/Build/jcamp_scan.hpp"
@@ -0,0 +1,523 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// benchmark of the jcamp-dx reader on a synthetic (or given) corpus
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Linux: g++ -std=c++11 -O2 -o jcampbench jcampbench.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+//   add -DJCAMP_TO_JSON to also time to_json()
+//
+// jcampbench [options] [file...]
+//   -n files    number of synthetic files (20)
+//   -l labels   labels per block (200)
+//   -a maxlen   longest array (256)
+//   -d depth    deepest ( ) group nesting (2)
+//   -s frac     fraction of string labels (0.3)
+//   -b blocks   ##BLOCKS per file, 1 for plain parameter files (1)
+//   -@          write runs as @N*(x), which the parser doesn't read yet
+//   -S seed     generator seed (1)
+//   -r repeats  passes over the corpus per benchmark (5)
+//   -g dir      just write the synthetic corpus into 'dir'
+//   -o file     also write the results as json to 'file'
+//   -f min      float tables are numeric arrays of at least 'min' values (64)
+//   -B name=n   fail (exit 3) if benchmark 'name' makes more than n
+//               allocations per LDR, may be repeated.  see testalloc.sh
+//
+//   with files, benchmarks those instead of generating.  times loadFile,
+//   loadString, label lookups, reading AcqusCore (ldrschema.hpp) label by
+//   label and as a schema, operator<<, to_json and the conversion mexldr
+//   does, reporting MB/s, LDRs/s, allocations per call and per LDR
+//   (every malloc, see allocprof.hpp), and the peak heap & rss.  then
+//   loads again keeping the big numeric tables as float (NumPolicy),
+//   comparing the memory the corpus takes and summing the tables both ways,
+//   and loads it twice more into an LdrPool, like two scans of a study,
+//   then again with the short strings coded in an LdrDict.
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "jcampdx.hpp"
+#include "jcampgen.hpp"
+#include "ldrschema.hpp"
+#include "allocprof.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_ERROR);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  std::cerr << location << ":" << str << "\n";
+}
+
+struct BenchResult
+{
+  string name;
+  double secs;          //!< per pass
+  double mbytes;        //!< per pass, 0 if not meaningful
+  double ldrs;          //!< per pass
+  double calls;         //!< api calls per pass
+  double allocs;        //!< per pass
+  double alloc_bytes;   //!< per pass
+  double peak;          //!< most heap in use at once, over the passes
+  double peak_rss;      //!< process high water mark during the passes
+  double retained;      //!< per pass, heap not freed again
+};
+
+template <typename FN>
+static BenchResult
+run(const string & name, int repeats, double bytes, double ldrs, double calls, FN fn)
+{
+  fn(); // warm up
+  AllocMark mark;
+  auto start = std::chrono::steady_clock::now();
+  for (int rr = 0; rr < repeats; rr++)
+    fn();
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  AllocStats used = mark.since();
+  BenchResult res = { name, secs / repeats, bytes / 1e6, ldrs, calls,
+                      double(used.allocs) / repeats, double(used.bytes) / repeats,
+                      double(used.peak), double(used.peak_rss),
+                      double(used.retained) / repeats };
+  printf("%-12s %9.3f ms", name.c_str(), res.secs * 1e3);
+  if (res.mbytes > 0)
+    printf(" %9.1f MB/s", res.mbytes / res.secs);
+  else
+    printf(" %14s", "");
+  printf(" %11.0f LDRs/s %9.1f %7.2f %9.1f %8.2f %8.1f\n",
+         res.ldrs / res.secs, res.allocs / res.calls, res.allocs / res.ldrs,
+         res.alloc_bytes / res.calls / 1e3, res.peak / 1e6, res.peak_rss / 1e6);
+  return res;
+}
+
+static size_t
+count_ldrs(Ldrset & ldrs)
+{
+  size_t count = ldrs.size();
+  for (size_t bb = 0; bb < ldrs.getBlockCount(); bb++)
+    count += count_ldrs(*ldrs.getBlock(bb));
+  return count;
+}
+
+// records with a code in an LdrDict, in groups too
+static size_t
+count_codes(const Ldr & ldr)
+{
+  size_t count = 0;
+  for (size_t ii = 0; ii < ldr.size(); ii++)
+    count += ldr.type(ii) == RECORD_GROUP ? count_codes(ldr.group(ii)) : ldr.code(ii) != 0;
+  return count;
+}
+
+static void
+add_sets(Ldrset & ldrs, std::vector<Ldrset *> & sets)
+{
+  sets.push_back(&ldrs);
+  for (size_t bb = 0; bb < ldrs.getBlockCount(); bb++)
+    add_sets(*ldrs.getBlock(bb), sets);
+}
+
+// what mexldr builds a struct from: '$'-less field names, a double matrix
+// for numbers, a cell of strings for text
+struct MexField
+{
+  string key;
+  std::vector<double> num;
+  std::vector<string> cells;
+};
+
+static void
+mexlike(const Ldrset & ldrs, std::vector<MexField> & fields)
+{
+  fields.clear();
+  for (auto & label : ldrs.getLabels()) {
+    MexField field;
+    field.key = label[0] == '$' ? label.substr(1) : label;
+    const Ldr & ldr = ldrs.getLdr(field.key);
+    std::vector<int> shape = ldr.shape();
+    size_t count = shape[0] * (shape.size() > 1 ? shape[1] : 1);
+    switch (ldr.type()) {
+    case RECORD_TEXT:
+    case RECORD_STRING:
+    case RECORD_QSTRING:
+      for (size_t jj = 0; jj < count; jj++)
+        field.cells.push_back(ldr.str(jj));
+      break;
+    case RECORD_NUMERIC:
+      for (size_t jj = 0; jj < count; jj++)
+        field.num.push_back(ldr.num(jj));
+      break;
+    default:
+      break;
+    }
+    fields.push_back(std::move(field));
+  }
+}
+
+static string
+slurp(const string & filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  stringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+static void
+write_json(const string & filename, const JcampGenParams & gen, bool synthetic,
+           size_t nfiles, size_t nbytes, size_t nldrs, size_t nfailed,
+           const std::vector<BenchResult> & results, const std::map<string, double> & memory)
+{
+  std::ofstream out(filename.c_str());
+  out << "{\n  \"corpus\": {\"synthetic\": " << (synthetic ? "true" : "false")
+      << ", \"files\": " << nfiles << ", \"bytes\": " << nbytes
+      << ", \"ldrs\": " << nldrs << ", \"failed\": " << nfailed;
+  if (synthetic)
+    out << ", \"seed\": " << gen.seed << ", \"labels\": " << gen.labels
+        << ", \"maxlen\": " << gen.maxlen << ", \"depth\": " << gen.depth
+        << ", \"strings\": " << gen.strings << ", \"blocks\": " << gen.blocks
+        << ", \"repeats\": " << (gen.repeats ? "true" : "false");
+  out << "},\n  \"memory\": {";
+  for (auto it = memory.begin(); it != memory.end(); it++)
+    out << (it == memory.begin() ? "" : ", ") << "\"" << it->first << "\": " << it->second;
+  out << "},\n  \"results\": [\n";
+  for (size_t ii = 0; ii < results.size(); ii++) {
+    const BenchResult & res = results[ii];
+    out << "    {\"name\": \"" << res.name << "\", \"seconds\": " << res.secs
+        << ", \"mb_per_s\": " << (res.mbytes > 0 ? res.mbytes / res.secs : 0)
+        << ", \"ldrs_per_s\": " << res.ldrs / res.secs
+        << ", \"calls\": " << res.calls
+        << ", \"allocs\": " << res.allocs << ", \"alloc_bytes\": " << res.alloc_bytes
+        << ", \"allocs_per_ldr\": " << res.allocs / res.ldrs
+        << ", \"peak_heap\": " << res.peak << ", \"peak_rss\": " << res.peak_rss
+        << ", \"retained\": " << res.retained
+        << "}" << (ii + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+  JcampGenParams gen;
+  int nfiles = 20, repeats = 5;
+  size_t mintable = 64;
+  string gendir, jsonfile;
+  std::vector<string> files;
+  std::map<string, double> budgets;
+  for (int ii = 1; ii < argc; ii++) {
+    string arg = argv[ii];
+    bool hasval = ii + 1 < argc;
+    if (arg == "-n" && hasval) nfiles = atoi(argv[++ii]);
+    else if (arg == "-l" && hasval) gen.labels = atoi(argv[++ii]);
+    else if (arg == "-a" && hasval) gen.maxlen = atoi(argv[++ii]);
+    else if (arg == "-d" && hasval) gen.depth = atoi(argv[++ii]);
+    else if (arg == "-s" && hasval) gen.strings = atof(argv[++ii]);
+    else if (arg == "-b" && hasval) gen.blocks = atoi(argv[++ii]);
+    else if (arg == "-@") gen.repeats = true;
+    else if (arg == "-S" && hasval) gen.seed = strtoull(argv[++ii], NULL, 0);
+    else if (arg == "-r" && hasval) repeats = atoi(argv[++ii]);
+    else if (arg == "-g" && hasval) gendir = argv[++ii];
+    else if (arg == "-o" && hasval) jsonfile = argv[++ii];
+    else if (arg == "-f" && hasval) mintable = strtoul(argv[++ii], NULL, 0);
+    else if (arg == "-B" && hasval && strchr(argv[ii + 1], '=')) {
+      string budget = argv[++ii];
+      budgets[budget.substr(0, budget.find('='))] = atof(budget.c_str() + budget.find('=') + 1);
+    }
+    else if (arg[0] == '-') {
+      std::cerr << "usage: " << argv[0] << " [-n files] [-l labels] [-a maxlen] [-d depth]"
+                << " [-s frac] [-b blocks] [-@] [-S seed] [-r repeats] [-g dir] [-o results.json]"
+                << " [-f mintable] [-B name=allocs/LDR]..."
+                << " [file...]\n";
+      return 1;
+    }
+    else
+      files.push_back(arg);
+  }
+  if (repeats < 1)
+    repeats = 1;
+
+  // the corpus, on disk for loadFile & in memory for loadString
+  bool synthetic = files.empty();
+  std::vector<string> contents;
+  if (synthetic) {
+    char tmpdir[] = "/tmp/jcampbench.XXXXXX";
+    string dir = gendir;
+    if (dir.empty()) {
+      if (!mkdtemp(tmpdir)) {
+        perror("mkdtemp");
+        return 1;
+      }
+      dir = tmpdir;
+    }
+    else
+      mkdir(dir.c_str(), 0777);
+    JcampGen generator(gen);
+    for (int ii = 0; ii < nfiles; ii++) {
+      files.push_back(dir + "/synth" + std::to_string(ii) + ".jdx");
+      contents.push_back(generator.file(ii));
+      std::ofstream out(files.back().c_str(), std::ios::binary);
+      out << contents.back();
+      if (!out) {
+        std::cerr << "unable to write " << files.back() << "\n";
+        return 1;
+      }
+    }
+    if (!gendir.empty()) {
+      std::cout << "wrote " << nfiles << " files to " << gendir << "\n";
+      return 0;
+    }
+  }
+  else
+    for (auto & filename : files)
+      contents.push_back(slurp(filename));
+  // the synthetic corpus goes into a scratch dir
+  auto cleanup = [&] {
+    if (!synthetic)
+      return;
+    for (auto & filename : files)
+      unlink(filename.c_str());
+    if (!files.empty())
+      rmdir(files[0].substr(0, files[0].rfind('/')).c_str());
+  };
+
+  // parse once to see what there is, drop what doesn't parse
+  std::vector<std::unique_ptr<Ldrset> > parsed;
+  std::vector<string> good, goodcontents;
+  size_t nbytes = 0, nldrs = 0, nfailed = 0;
+  for (size_t ii = 0; ii < files.size(); ii++) {
+    std::unique_ptr<Ldrset> ldrs(new Ldrset());
+    try {
+      ldrs->loadString(contents[ii], files[ii]);
+    }
+    catch (const std::exception & ex) {
+      if (!nfailed++)
+        std::cerr << "not parsed, left out: " << ex.what() << "\n";
+      continue;
+    }
+    good.push_back(files[ii]);
+    goodcontents.push_back(contents[ii]);
+    nbytes += contents[ii].size();
+    nldrs += count_ldrs(*ldrs);
+    parsed.push_back(std::move(ldrs));
+  }
+  printf("%zu files, %.2f MB, %zu LDRs", good.size(), nbytes / 1e6, nldrs);
+  if (nfailed)
+    printf(", %zu failed to parse", nfailed);
+  printf("\n");
+  printf("%-12s %12s %14s %18s %9s %7s %9s %8s %8s\n", "", "per pass", "", "",
+         "allocs/", "allocs/", "KB/call", "peak", "peak");
+  printf("%-12s %12s %14s %18s %9s %7s %9s %8s %8s\n", "", "", "", "",
+         "call", "LDR", "", "heap MB", "rss MB");
+  if (good.empty()) {
+    cleanup();
+    return 2;
+  }
+
+  std::vector<BenchResult> results;
+  results.push_back(run("loadFile", repeats, nbytes, nldrs, good.size(), [&] {
+        for (auto & filename : good) {
+          Ldrset ldrs;
+          ldrs.loadFile(filename);
+        }
+      }));
+  results.push_back(run("loadString", repeats, nbytes, nldrs, good.size(), [&] {
+        for (size_t ii = 0; ii < good.size(); ii++) {
+          Ldrset ldrs;
+          ldrs.loadString(goodcontents[ii], good[ii]);
+        }
+      }));
+
+  // every set, blocks too, for the per-label benchmarks
+  std::vector<Ldrset *> sets;
+  for (auto & ldrs : parsed)
+    add_sets(*ldrs, sets);
+  std::vector<std::vector<string> > labels;
+  size_t nlabels = 0;
+  for (auto set : sets) {
+    std::set<string> ll = set->getLabels();
+    labels.emplace_back(ll.begin(), ll.end());
+    nlabels += ll.size();
+  }
+  size_t found = 0;
+  results.push_back(run("getLdr", repeats, 0, nlabels, nlabels, [&] {
+        for (size_t ii = 0; ii < sets.size(); ii++)
+          for (auto & label : labels[ii])
+            found += sets[ii]->getLdr(label).size();
+      }));
+
+  // the acqus parameters a consumer wants, from a set as big as the
+  // corpus' first, looked up one by one and then read as a schema
+  Ldrset acqus(*parsed[0]);
+  std::vector<string> acquslabels;
+  size_t nfields;
+  const LdrField<AcqusCore> * schema = LdrSchema<AcqusCore>::fields(nfields);
+  for (size_t ii = 0; ii < nfields; ii++) {
+    acquslabels.push_back(schema[ii].label);
+    acqus.setDouble(schema[ii].label, (real_t)ii, 0, true);
+  }
+  const int acqusreads = 1000;
+  double acqussum = 0;
+  results.push_back(run("acqus/get", repeats, 0, acqusreads * nfields, acqusreads, [&] {
+        for (int ii = 0; ii < acqusreads; ii++)
+          for (auto & label : acquslabels)
+            if (acqus.labelExists(label))
+              acqussum += acqus.getDouble(label);
+      }));
+  results.push_back(run("acqus/schema", repeats, 0, acqusreads * nfields, acqusreads, [&] {
+        for (int ii = 0; ii < acqusreads; ii++) {
+          AcqusCore pars;
+          found += ldr_schema_load(acqus, pars).count();
+          acqussum += pars.SW_h;
+        }
+      }));
+
+  size_t printed = 0;
+  for (auto & ldrs : parsed) {
+    stringstream out;
+    out << *ldrs;
+    printed += out.str().size();
+  }
+  results.push_back(run("operator<<", repeats, printed, nldrs, parsed.size(), [&] {
+        for (auto & ldrs : parsed) {
+          stringstream out;
+          out << *ldrs;
+        }
+      }));
+
+#ifdef JCAMP_TO_JSON
+  results.push_back(run("to_json", repeats, 0, nldrs, parsed.size(), [&] {
+        for (auto & ldrs : parsed)
+          json jj = ldrs->to_json();
+      }));
+#endif
+
+  std::vector<MexField> fields;
+  results.push_back(run("mexldr", repeats, 0, nlabels, sets.size(), [&] {
+        for (auto set : sets)
+          mexlike(*set, fields);
+      }));
+
+  // the same again with numeric arrays of 'mintable' or more values kept
+  // as float: loading, the memory the corpus takes, and reading the tables
+  NumPolicy floats(true, mintable);
+  results.push_back(run("loadFile/f32", repeats, nbytes, nldrs, good.size(), [&] {
+        for (auto & filename : good) {
+          Ldrset ldrs;
+          ldrs.setNumPolicy(floats);
+          ldrs.loadFile(filename);
+        }
+      }));
+  std::map<string, double> memory;
+  std::vector<std::unique_ptr<Ldrset> > kept[2];
+  std::vector<const Ldr *> tables[2];
+  size_t nvalues = 0;
+  for (int ff = 0; ff < 2; ff++) {
+    AllocMark mark;
+    for (auto & filename : good) {
+      kept[ff].emplace_back(new Ldrset());
+      if (ff)
+        kept[ff].back()->setNumPolicy(floats);
+      kept[ff].back()->loadFile(filename);
+    }
+    memory[ff ? "held_f32" : "held_f64"] = mark.since().retained;
+    std::vector<Ldrset *> all;
+    for (auto & ldrs : kept[ff])
+      add_sets(*ldrs, all);
+    for (auto set : all)
+      for (auto & label : set->getLabels()) {
+        const Ldr & ldr = set->getLdr(label);
+        if (ldr.isNumeric() && ldr.size() >= mintable) {
+          tables[ff].push_back(&ldr);
+          nvalues += ff ? 0 : ldr.size();
+        }
+      }
+  }
+  double sum = 0;
+  results.push_back(run("sum/f64", repeats, nvalues * sizeof(double), nvalues, tables[0].size(), [&] {
+        for (auto ldr : tables[0]) {
+          const double * vals = ldr->nums<double>();
+          for (size_t ii = 0; ii < ldr->size(); ii++)
+            sum += vals[ii];
+        }
+      }));
+  results.push_back(run("sum/f32", repeats, nvalues * sizeof(float), nvalues, tables[1].size(), [&] {
+        for (auto ldr : tables[1]) {
+          const float * vals = ldr->nums<float>();
+          for (size_t ii = 0; ii < ldr->size(); ii++)
+            sum += vals[ii];
+        }
+      }));
+  printf("held: %.2f MB as double, %.2f MB with %zu tables (%zu values) of %zu+ as float\n",
+         memory["held_f64"] / 1e6, memory["held_f32"] / 1e6, tables[1].size(), nvalues, mintable);
+
+  // a second copy of the corpus sharing a pool with the first costs only
+  // the maps, the ldrs are the first copy's
+  {
+    std::shared_ptr<LdrPool> pool = std::make_shared<LdrPool>();
+    std::vector<std::unique_ptr<Ldrset> > twice;
+    AllocMark mark;
+    for (int copy = 0; copy < 2; copy++)
+      for (auto & filename : good) {
+        twice.emplace_back(new Ldrset());
+        twice.back()->setPool(pool);
+        twice.back()->loadFile(filename);
+      }
+    memory["held_pool_x2"] = mark.since().retained;
+    printf("pool: %.2f MB for the corpus twice, %zu distinct ldrs\n",
+           memory["held_pool_x2"] / 1e6, pool->size());
+  }
+  // the same with the short strings coded, and how many values that is
+  {
+    std::shared_ptr<LdrPool> pool = std::make_shared<LdrPool>();
+    std::shared_ptr<LdrDict> dict = std::make_shared<LdrDict>();
+    std::vector<std::unique_ptr<Ldrset> > twice;
+    AllocMark mark;
+    for (int copy = 0; copy < 2; copy++)
+      for (auto & filename : good) {
+        twice.emplace_back(new Ldrset());
+        twice.back()->setPool(pool);
+        twice.back()->setDict(dict);
+        twice.back()->loadFile(filename);
+      }
+    memory["held_dict_x2"] = mark.since().retained;
+    size_t coded = 0;
+    for (auto & ldrs : twice)
+      for (auto & label : ldrs->getLabels())
+        coded += count_codes(((const Ldrset &)*ldrs).getLdr(label));
+    printf("dict: %.2f MB for the corpus twice, %zu strings coded as %zu\n",
+           memory["held_dict_x2"] / 1e6, coded, dict->size());
+  }
+  if (sum == 0 && acqussum == 0)
+    found = 0;
+
+  cleanup();
+
+  if (!jsonfile.empty())
+    write_json(jsonfile, gen, synthetic, good.size(), nbytes, nldrs, nfailed, results, memory);
+
+  // allocation regressions
+  int over = 0;
+  for (auto & budget : budgets) {
+    auto res = std::find_if(results.begin(), results.end(),
+                            [&](const BenchResult & rr) { return rr.name == budget.first; });
+    if (res == results.end()) {
+      std::cerr << "no benchmark " << budget.first << " to budget\n";
+      over++;
+    }
+    else if (res->allocs / res->ldrs > budget.second) {
+      fprintf(stderr, "over budget: %s makes %.2f allocs/LDR, budget %g\n",
+              res->name.c_str(), res->allocs / res->ldrs, budget.second);
+      over++;
+    }
+  }
+  if (over)
+    return 3;
+  return found ? 0 : 2;
+}
@@ -12,21 +12,42 @@
 
 #include <limits>
 #include <algorithm>
+#include <cstring>
 
 #include "jcampdx.hpp"
 #include "jcamp_scan.hpp"
 #include "jcamp_parse.hpp"
+#include "counters.hpp"
+#include "trace.hpp"
 
 #ifndef NDEBUG
-#define DEBUG (getenv("DEBUG") ? 2 : 0)
+// $DEBUG turns on scanner tracing and the INFO messages below, looked up
+// once rather than for every record
+static const bool s_debug = getenv("DEBUG") != NULL;
+#define DEBUG s_debug
 #else
 #define DEBUG 0
 #endif
 
 #ifndef jcamp_yyparse
-int jcamp_yyparse (Ldrset & jdx, yyscan_t scanner);
+int jcamp_yyparse (JcampParse & jdx, yyscan_t scanner);
 #endif
 
+static Counter c_files("jcamp.load.files");
+static Counter c_failed("jcamp.load.failed");
+static Counter c_ldrs("jcamp.load.ldrs");
+static Counter c_records("jcamp.records");
+static Counter c_strrecords("jcamp.records.str");
+static Counter c_grouprecords("jcamp.records.group");
+static Counter c_retyped("jcamp.records.retyped");
+static Counter c_reallocs("jcamp.records.reallocs");
+static Counter c_lookups("jcamp.lookups");
+static Counter c_floattables("jcamp.ldrs.float");
+static Counter c_missed("jcamp.lookups.missed");
+static Counter c_shared("jcamp.ldrs.shared");
+static Counter c_unshared("jcamp.ldrs.unshared");
+static Counter c_coded("jcamp.records.coded");
+
 #ifdef _WIN32
 #include <malloc.h>
 
@@ -59,7 +80,7 @@ ostream & operator <<(ostream & out, Ldr::Record const & rr)
     out << "<" << rr._str << ">";
     break;
   case RECORD_NUMERIC:
-    out << rr._num;
+    out << rr._str;
     break;
   case RECORD_UNSET:
     out << "?";
@@ -78,8 +99,16 @@ ostream & operator <<(ostream & out, Ldr const & l)
       out << "##" << l._label << "=";
     if (l._shape_type != Ldr::SHAPE_1D)
       out << "(" << l._data.size() << ")\n";
-    for (auto it = l._data.begin(); it != l._data.end(); it++)
-      out << *it << " ";
+    for (size_t ii = 0; ii < l._data.size(); ii++) {
+      if (l._data[ii]._type == RECORD_NUMERIC)
+        out << (l._float ? l._fnum[ii] : l._num[ii]) << " ";
+      else if (l._data[ii]._code && l._data[ii]._type == RECORD_QSTRING)
+        out << "<" << l.str(ii) << "> ";
+      else if (l._data[ii]._code)
+        out << l.str(ii) << " ";
+      else
+        out << l._data[ii] << " ";
+    }
   }
   catch (const std::exception & ex) {
     ERROR("error in Ldr '" << l._label << ex.what() << "'\n");
@@ -90,15 +119,15 @@ ostream & operator <<(ostream & out, Ldr const & l)
 
 ostream & operator <<(ostream & out, Ldrset const & l)
 {
-  for (auto li = l._ldrs.begin(); li != l._ldrs.end(); li++)
+  for (auto li = l._ldrs->begin(); li != l._ldrs->end(); li++)
     if (li->first == "TITLE")
-      out << li->second << "\n";
-  for (auto li = l._ldrs.begin(); li != l._ldrs.end(); li++)
+      out << *li->second << "\n";
+  for (auto li = l._ldrs->begin(); li != l._ldrs->end(); li++)
     if (li->first[0] != '$' && li->first != "TITLE")
-      out << li->second << "\n";
-  for (auto li = l._ldrs.begin(); li != l._ldrs.end(); li++)
+      out << *li->second << "\n";
+  for (auto li = l._ldrs->begin(); li != l._ldrs->end(); li++)
     if (li->first[0] == '$')
-      out << li->second << "\n";
+      out << *li->second << "\n";
   for (auto & li : l._blocks)
     out << *li;
   out << "##END=\n";
@@ -108,42 +137,26 @@ ostream & operator <<(ostream & out, Ldrset const & l)
 // //////////////////////////////////////////////////////////
 // Record
 Ldr::Record::Record()
-  : _type(RECORD_UNSET), _num(0), _ldr(NULL)
+  : _type(RECORD_UNSET), _code(0)
 {
 }
 
 Ldr::Record::Record(const string & str, bool quoted)
-  : _type(quoted ? RECORD_QSTRING : RECORD_STRING), _str(str), _num(0), _ldr(NULL)
+  : _type(quoted ? RECORD_QSTRING : RECORD_STRING), _code(0), _str(str)
 {
-  try {
-    _num = std::stod(str);
-  }
-  catch (...) {
-#ifdef __EMSCRIPTEN__
-    _num = 0;
-#else
-    _num = std::numeric_limits<real_t>::signaling_NaN();
-#endif
-  }
 }
 
 Ldr::Record::Record(real_t val)
-  : _type(RECORD_NUMERIC), _num(val), _ldr(NULL)
+  : _type(RECORD_NUMERIC), _code(0)
 {
   _str = std::to_string(val);
 }
 
 Ldr::Record::Record(Ldr * ldr)
-  : _type(RECORD_GROUP), _ldr(ldr)
+  : _type(RECORD_GROUP), _code(0), _ldr(ldr)
 {
 }
 
-const real_t &
-Ldr::Record::num() const
-{
-  return _num;
-}
-
 const string &
 Ldr::Record::str() const
 {
@@ -156,16 +169,10 @@ Ldr::Record::type() const
   return _type;
 }
 
-void
-Ldr::Record::setNum(real_t val)
-{
-  _num = val;
-  _type = RECORD_NUMERIC;
-}
-
 void
 Ldr::Record::setStr(const string & str, bool quoted)
 {
+  _code = 0;
   _str = str;
   _type = quoted ? RECORD_QSTRING : RECORD_STRING;
 }
@@ -204,31 +211,108 @@ Label::Label(string name)
   string::assign(name);
 }
 
+// //////////////////////////////////////////////////////////
+// LdrDict
+
+LdrDict::LdrDict()
+  : _next(1)
+{
+  for (auto & chunk : _chunks)
+    chunk.store(NULL, std::memory_order_relaxed);
+}
+
+LdrDict::~LdrDict()
+{
+  for (auto & chunk : _chunks)
+    delete [] chunk.load(std::memory_order_relaxed);
+}
+
+uint32_t
+LdrDict::code(const string & str)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _codes.find(str);
+  if (it != _codes.end())
+    return it->second;
+  if (_next >= (uint32_t)CHUNK * CHUNKS)
+    return 0;
+  // a chunk is never moved, so str() can read without the lock
+  uint32_t code = _next++;
+  string * chunk = _chunks[code / CHUNK].load(std::memory_order_relaxed);
+  if (!chunk) {
+    chunk = new string[CHUNK];
+    _chunks[code / CHUNK].store(chunk, std::memory_order_release);
+  }
+  chunk[code % CHUNK] = str;
+  _codes.emplace(str, code);
+  return code;
+}
+
+uint32_t
+LdrDict::find(const string & str) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _codes.find(str);
+  return it == _codes.end() ? 0 : it->second;
+}
+
+const string &
+LdrDict::str(uint32_t code) const
+{
+  string * chunk = code ? _chunks[code / CHUNK].load(std::memory_order_acquire) : NULL;
+  if (!chunk)
+    throw std::out_of_range("LdrDict::str no such code: " + std::to_string(code));
+  return chunk[code % CHUNK];
+}
+
+size_t
+LdrDict::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _codes.size();
+}
+
 // //////////////////////////////////////////////////////////
 // Ldr
 
+// the numeric value of a string record, if it has one
+static real_t
+strToNum(const string & str)
+{
+  try {
+    return std::stod(str);
+  }
+  catch (...) {
+#ifdef __EMSCRIPTEN__
+    return 0;
+#else
+    return std::numeric_limits<real_t>::signaling_NaN();
+#endif
+  }
+}
+
 Ldr::Ldr()
-  : _shape_type(SHAPE_1D)
+  : _float(false), _nonnum(0), _shape_type(SHAPE_1D)
 {
 }
 
 Ldr::Ldr(const string & label)
-  : _label(label), _shape_type(SHAPE_1D)
+  : _float(false), _nonnum(0), _label(label), _shape_type(SHAPE_1D)
 {
 }
 
 Ldr::Ldr(record_type type, const string & str, const string & label)
-  : _label(label), _shape_type(SHAPE_1D)
+  : _float(false), _nonnum(0), _label(label), _shape_type(SHAPE_1D)
 {
   appendStr(str);
-  _data.back().setType(type);
+  retype(0, type);
 }
 
 Ldr::Ldr(record_type type, real_t val, const string & label)
-  : _label(label), _shape_type(SHAPE_1D)
+  : _float(false), _nonnum(0), _label(label), _shape_type(SHAPE_1D)
 {
   appendNum(val);
-  _data.back().setType(type);
+  retype(0, type);
 }
 
 size_t
@@ -244,6 +328,17 @@ Ldr::shape() const
   return d;
 }
 
+std::vector<int>
+Ldr::dims() const
+{
+  size_t count = 1;
+  for (int dd : _shape)
+    count *= dd > 0 ? dd : 0;
+  if (_shape.size() && count == _data.size())
+    return _shape;
+  return shape();
+}
+
 string
 Ldr::label() const
 {
@@ -258,10 +353,23 @@ Ldr::str(size_t idx) const
     str << "Ldr::str " << _label << " index error: '" << idx << "/" << _data.size() << "'";
     throw std::out_of_range(str.str());
   }
-  return _data.at(idx).str();
+  const Record & rec = _data[idx];
+  return rec._code ? _dict->str(rec._code) : rec._str;
+}
+
+uint32_t
+Ldr::code(size_t idx) const
+{
+  if (idx >= _data.size()) {
+    stringstream str;
+    str << "Ldr::code " << _label << " index error: '" << idx << "/" << _data.size() << "'";
+    throw std::out_of_range(str.str());
+  }
+  return _data[idx]._code;
 }
 
-const real_t &
+template <typename T>
+T
 Ldr::num(size_t idx) const
 {
   if (idx >= _data.size()) {
@@ -269,8 +377,10 @@ Ldr::num(size_t idx) const
     str << "Ldr::num " << _label << " index error: '" << idx << "/" << _data.size() << "'";
     throw std::out_of_range(str.str());
   }
-  return _data.at(idx).num();
+  return _float ? (T)_fnum[idx] : (T)_num[idx];
 }
+template double Ldr::num<double>(size_t idx) const;
+template float Ldr::num<float>(size_t idx) const;
 
 record_type
 Ldr::type(size_t idx) const
@@ -283,20 +393,123 @@ Ldr::type(size_t idx) const
   return _data.at(idx).type();
 }
 
+const Ldr &
+Ldr::group(size_t idx) const
+{
+  if (idx >= _data.size()) {
+    stringstream str;
+    str << "Ldr::group " << _label << " index error: '" << idx << "/" << _data.size() << "'";
+    throw std::out_of_range(str.str());
+  }
+  return _data.at(idx).group();
+}
+
+template <typename T>
+const T *
+Ldr::nums() const
+{
+  // only the one in use has anything in it
+  const std::vector<T> & vals = values((const T *)NULL);
+  return vals.empty() ? NULL : &vals[0];
+}
+template const double * Ldr::nums<double>() const;
+template const float * Ldr::nums<float>() const;
+
+template <typename T>
+size_t
+Ldr::copyNums(T * out, size_t n) const
+{
+  size_t count = std::min(n, _data.size());
+  if (out && _float)
+    std::copy(_fnum.begin(), _fnum.begin() + count, out);
+  else if (out)
+    std::copy(_num.begin(), _num.begin() + count, out);
+  return _data.size();
+}
+template size_t Ldr::copyNums<double>(double * out, size_t n) const;
+template size_t Ldr::copyNums<float>(float * out, size_t n) const;
+
+bool
+Ldr::floatStorage() const
+{
+  return _float;
+}
+
 void
-Ldr::setStr(const string & str, size_t idx)
+Ldr::setFloatStorage(bool floats)
+{
+  if (floats == _float)
+    return;
+  if (floats) {
+    _fnum.assign(_num.begin(), _num.end());
+    std::vector<double>().swap(_num);
+  }
+  else {
+    _num.assign(_fnum.begin(), _fnum.end());
+    std::vector<float>().swap(_fnum);
+  }
+  _float = floats;
+}
+
+bool
+Ldr::isNumeric() const
+{
+  return _data.size() && !_nonnum;
+}
+
+// add unset records up to idx
+// count a record about to be appended, and whether the arrays move for it
+void
+Ldr::counted_append()
 {
-  if (idx >= _data.size())
+  c_records.add();
+  if (_data.size() == _data.capacity())
+    c_reallocs.add();
+}
+
+void
+Ldr::grow(size_t idx)
+{
+  if (idx >= _data.size()) {
+    _nonnum += idx + 1 - _data.size();
     _data.resize(idx+1);
+    if (_float)
+      _fnum.resize(idx+1, 0);
+    else
+      _num.resize(idx+1, 0);
+  }
+}
+
+// change a record's type, keeping count of the non-numeric ones
+void
+Ldr::retype(size_t idx, record_type type)
+{
+  if (_data[idx].type() == RECORD_NUMERIC)
+    _nonnum++;
+  if (type == RECORD_NUMERIC)
+    _nonnum--;
+  if (type != _data[idx].type())
+    c_retyped.add();
+  _data[idx].setType(type);
+}
+
+void
+Ldr::setStr(const string & str, size_t idx)
+{
+  grow(idx);
+  retype(idx, RECORD_STRING);
   _data[idx].setStr(str);
 }
 
 void
 Ldr::setNum(real_t val, size_t idx)
 {
-  if (idx >= _data.size())
-    _data.resize(idx+1);
-  _data[idx].setNum(val);
+  grow(idx);
+  retype(idx, RECORD_NUMERIC);
+  if (_float)
+    _fnum[idx] = (float)val;
+  else
+    _num[idx] = val;
 }
 
 void
@@ -329,36 +542,188 @@ void
 Ldr::setShape(const Ldr & ldr)
 {
   for (size_t ii = 0; ii < ldr.size(); ii++)
-    _shape.push_back((int)ldr.num());
+    _shape.push_back((int)ldr.num(ii));
   _shape_type = SHAPE_XYXY;
 }
 
 void
 Ldr::appendStr(const string & str, bool quoted)
 {
+  counted_append();
+  c_strrecords.add();
   _data.emplace_back(str, quoted);
+  pushNum(strToNum(str));
+  _nonnum++;
 }
 
 void
 Ldr::appendNum(real_t val)
 {
+  counted_append();
   _data.emplace_back(val);
+  pushNum(val);
+}
+
+void
+Ldr::pushNum(real_t val)
+{
+  if (_float)
+    _fnum.push_back((float)val);
+  else
+    _num.push_back(val);
 }
 
 void
 Ldr::appendGroup(Ldr * group)
 {
+  counted_append();
+  c_grouprecords.add();
   _data.emplace_back(group);
+  pushNum(0);
+  _nonnum++;
+}
+
+// the numbers are compared & hashed as bits, a string record's NaN equals itself
+template <typename T>
+static bool
+sameBits(const std::vector<T> & aa, const std::vector<T> & bb)
+{
+  return aa.size() == bb.size() && (aa.empty() || !memcmp(&aa[0], &bb[0], aa.size() * sizeof(T)));
+}
+
+static size_t
+hashMix(size_t seed, size_t val)
+{
+  return seed ^ (val + (size_t)0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// fnv-1a, std::hash would want a string made of them
+template <typename T>
+static size_t
+hashBits(size_t seed, const std::vector<T> & vals)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  const unsigned char * bytes = vals.empty() ? NULL : (const unsigned char *)&vals[0];
+  for (size_t ii = 0; ii < vals.size() * sizeof(T); ii++)
+    hash = (hash ^ bytes[ii]) * 1099511628211ULL;
+  return hashMix(seed, (size_t)hash);
+}
+
+bool
+Ldr::operator==(const Ldr & other) const
+{
+  if (this == &other)
+    return true;
+  if (_label != other._label || _float != other._float || _shape_type != other._shape_type ||
+      _dict != other._dict ||
+      _shape != other._shape || _data.size() != other._data.size() ||
+      !sameBits(_num, other._num) || !sameBits(_fnum, other._fnum))
+    return false;
+  for (size_t ii = 0; ii < _data.size(); ii++) {
+    const Record & aa = _data[ii];
+    const Record & bb = other._data[ii];
+    if (aa._type != bb._type || aa._code != bb._code || aa._str != bb._str)
+      return false;
+    if (aa._ldr != bb._ldr && (!aa._ldr || !bb._ldr || *aa._ldr != *bb._ldr))
+      return false;
+  }
+  return true;
+}
+
+size_t
+Ldr::hash() const
+{
+  std::hash<string> hasher;
+  size_t seed = hasher(_label);
+  seed = hashMix(seed, _data.size());
+  seed = hashMix(seed, _float);
+  for (auto & rec : _data) {
+    seed = hashMix(seed, rec._type);
+    if (rec._code)
+      seed = hashMix(seed, rec._code);
+    else if (rec._type != RECORD_NUMERIC)
+      seed = hashMix(seed, hasher(rec._str));
+    if (rec._ldr)
+      seed = hashMix(seed, rec._ldr->hash());
+  }
+  return _float ? hashBits(seed, _fnum) : hashBits(seed, _num);
+}
+
+// swap the short strings for codes in 'dict', down into the groups.  only
+// for a freshly parsed ldr, the groups aren't shared with anything yet
+void
+Ldr::encode(const std::shared_ptr<LdrDict> & dict)
+{
+  if (_dict && _dict != dict)
+    return;
+  for (auto & rec : _data) {
+    if (rec._type == RECORD_GROUP && rec._ldr)
+      const_cast<Ldr &>(*rec._ldr).encode(dict);
+    else if ((rec._type == RECORD_STRING || rec._type == RECORD_QSTRING) && !rec._code &&
+             rec._str.size() <= LdrDict::MAXLEN) {
+      rec._code = dict->code(rec._str);
+      if (!rec._code)
+        continue;
+      string().swap(rec._str);
+      _dict = dict;
+      c_coded.add();
+    }
+  }
+}
+
+// //////////////////////////////////////////////////////////
+// LdrPool
+
+std::shared_ptr<const Ldr>
+LdrPool::intern(const std::shared_ptr<const Ldr> & ldr)
+{
+  size_t hash = ldr->hash();
+  Shard & shard = _shards[hash % SHARDS];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto range = shard.ldrs.equal_range(hash);
+  for (auto it = range.first; it != range.second; ) {
+    std::shared_ptr<const Ldr> pooled = it->second.lock();
+    if (!pooled)
+      it = shard.ldrs.erase(it);
+    else if (*pooled == *ldr)
+      return pooled;
+    else
+      it++;
+  }
+  // every so often forget the ldrs no set holds anymore
+  if (++shard.added > shard.ldrs.size()) {
+    for (auto it = shard.ldrs.begin(); it != shard.ldrs.end(); )
+      it = it->second.expired() ? shard.ldrs.erase(it) : ++it;
+    shard.added = 0;
+  }
+  // sets intern ldrs fresh from a parse, nothing else looks at them yet
+  const_cast<Ldr &>(*ldr)._pooled.set = true;
+  shard.ldrs.emplace(hash, ldr);
+  return ldr;
+}
+
+size_t
+LdrPool::size() const
+{
+  size_t count = 0;
+  for (auto & shard : _shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto & it : shard.ldrs)
+      count += !it.second.expired();
+  }
+  return count;
 }
 
 // //////////////////////////////////////////////////////////
 // Ldrset
 
 Ldrset::Ldrset()
+  : _ldrs(std::make_shared<LdrMap>())
 {
 }
 
 Ldrset::Ldrset(const string & filename)
+  : _ldrs(std::make_shared<LdrMap>())
 {
   loadFile(filename);
 }
@@ -370,7 +735,28 @@ Ldrset::~Ldrset()
 size_t
 Ldrset::size() const
 {
-  return _ldrs.size();
+  return _ldrs->size();
+}
+
+Ldrset::LdrMap &
+Ldrset::ldrs()
+{
+  if (_ldrs.use_count() > 1)
+    _ldrs = std::make_shared<LdrMap>(*_ldrs);
+  return *_ldrs;
+}
+
+// a pooled ldr is copied even if nothing else holds it, the pool could
+// hand it out again any time.  the copy isn't pooled, it's changed in place
+// from then on
+Ldr &
+Ldrset::ldr(LdrMap::iterator it)
+{
+  if (it->second->_pooled.set || it->second.use_count() > 1) {
+    c_unshared.add();
+    it->second = std::make_shared<Ldr>(*it->second);
+  }
+  return const_cast<Ldr &>(*it->second);
 }
 
 void
@@ -380,17 +766,19 @@ Ldrset::loadFile(const string & filename)
   extern int jcamp_yydebug;
 #endif
 
+  TRACE_SPAN("Ldrset::loadFile", filename);
+  c_files.add();
   FILE *fp = fopen(filename.c_str(), "r");
 
   if (!fp) {
+    c_failed.add();
     stringstream str;
     str << "invalid input file: " << filename << ": " << strerror(errno) << "\n";
     throw std::invalid_argument(str.str());
   }
 
   // set lex to read from it instead of defaulting to STDIN:
-  _curfilename = filename;
-  jcamp_topnode = NULL;
+  JcampParse parse(filename);
 
   yyscan_t scanner;
   jcamp_yylex_init(&scanner);
@@ -403,27 +791,27 @@ Ldrset::loadFile(const string & filename)
   //jcamp_yyset_lineno(0, scanner);
   //jcamp_yyset_column(0, scanner);
   try {
-    if (jcamp_yyparse(*this, scanner))
+    // reading, scanning and parsing are interleaved, the scanner pulls
+    TRACE_SPAN("parse");
+    if (jcamp_yyparse(parse, scanner))
       ERROR("parse of '" << filename << "' failed\n");
   }
   catch (const std::exception & ex) {
+    c_failed.add();
     jcamp_yylex_destroy(scanner);
+    fclose(fp);
     throw;
   }
 
-  if (DEBUG) INFO("parse done " << jcamp_topnode << "\n");
+  jcamp_yylex_destroy(scanner);
+  if (DEBUG) INFO("parse done " << parse.topnode << "\n");
 
   fclose(fp);
-
-  // newly loaded ldrs override existing ldrs
-  jcamp_topnode->_ldrs.insert(_ldrs.begin(), _ldrs.end());
-  std::swap(jcamp_topnode->_ldrs, _ldrs);
-  // these are just pointers, so nothing will be overridden, just combined. maybe should
-  // someday fix (todo) so that blocks with same TITLE get combined.
-  _blocks.insert(_blocks.end(), jcamp_topnode->_blocks.begin(), jcamp_topnode->_blocks.end());
-  delete jcamp_topnode;
-  jcamp_topnode = NULL;
-  validate();
+  if (!parse.topnode) {
+    c_failed.add();
+    throw std::invalid_argument("no jcamp-dx data in " + filename);
+  }
+  adopt(parse.topnode);
 }
 
 void
@@ -433,9 +821,10 @@ Ldrset::loadString(const string & jdxstring, const string & nametag)
   extern int jcamp_yydebug;
 #endif
 
+  TRACE_SPAN("Ldrset::loadString", nametag);
+  c_files.add();
   // set lex to read from it instead of defaulting to STDIN:
-  _curfilename = nametag;
-  jcamp_topnode = NULL;
+  JcampParse parse(nametag);
 
   yyscan_t scanner;
   jcamp_yylex_init(&scanner);
@@ -450,10 +839,12 @@ Ldrset::loadString(const string & jdxstring, const string & nametag)
   jcamp_yyset_column(0, scanner);
 
   try {
-    if (jcamp_yyparse(*this, scanner))
+    TRACE_SPAN("parse");
+    if (jcamp_yyparse(parse, scanner))
       ERROR("parse of string failed\n");
   }
   catch (const std::exception & ex) {
+    c_failed.add();
     jcamp_yylex_destroy(scanner);
     throw;
   }
@@ -461,23 +852,135 @@ Ldrset::loadString(const string & jdxstring, const string & nametag)
   jcamp_yylex_destroy(scanner);
 
   if (DEBUG)
-    INFO("parse done " << jcamp_topnode << "\n");
+    INFO("parse done " << parse.topnode << "\n");
+
+  if (!parse.topnode) {
+    c_failed.add();
+    throw std::invalid_argument("no jcamp-dx data in " + nametag);
+  }
+  adopt(parse.topnode);
+}
+
+void
+Ldrset::setNumPolicy(const NumPolicy & policy)
+{
+  _policy = policy;
+}
+
+const NumPolicy &
+Ldrset::numPolicy() const
+{
+  return _policy;
+}
+
+void
+Ldrset::setPool(const std::shared_ptr<LdrPool> & pool)
+{
+  _pool = pool;
+}
+
+void
+Ldrset::setDict(const std::shared_ptr<LdrDict> & dict)
+{
+  _dict = dict;
+}
+
+const std::shared_ptr<LdrDict> &
+Ldrset::dict() const
+{
+  return _dict;
+}
+
+uint32_t
+Ldrset::findCode(const string & str) const
+{
+  return _dict ? _dict->find(str) : 0;
+}
+
+bool
+Ldrset::shares(const Ldrset & other, const string & label) const
+{
+  auto mine = _ldrs->find(label);
+  auto theirs = other._ldrs->find(label);
+  return mine != _ldrs->end() && theirs != other._ldrs->end() && mine->second == theirs->second;
+}
+
+// store the big numeric tables as float if the policy says so
+void
+Ldrset::applyNumPolicy(const NumPolicy & policy)
+{
+  _policy = policy;
+  if (policy.float_tables)
+    for (auto it = ldrs().begin(); it != _ldrs->end(); it++)
+      if (it->second->size() >= policy.min_table && it->second->isNumeric()) {
+        ldr(it).setFloatStorage(true);
+        c_floattables.add();
+      }
+  for (auto & block : _blocks)
+    block->applyNumPolicy(policy);
+}
+
+// code the short strings of a freshly parsed set
+void
+Ldrset::encode(const std::shared_ptr<LdrDict> & dict)
+{
+  _dict = dict;
+  for (auto it = ldrs().begin(); it != _ldrs->end(); it++)
+    if (!it->second->isNumeric())
+      ldr(it).encode(dict);
+  for (auto & block : _blocks)
+    block->encode(dict);
+}
 
-  // newly loaded ldrs override existing ldrs
-  jcamp_topnode->_ldrs.insert(_ldrs.begin(), _ldrs.end());
-  std::swap(jcamp_topnode->_ldrs, _ldrs);
+// swap each ldr for an equal one already in the pool, if there is one
+void
+Ldrset::intern(const std::shared_ptr<LdrPool> & pool)
+{
+  _pool = pool;
+  for (auto & it : ldrs()) {
+    std::shared_ptr<const Ldr> shared = pool->intern(it.second);
+    if (shared != it.second) {
+      c_shared.add();
+      it.second = shared;
+    }
+  }
+  for (auto & block : _blocks)
+    block->intern(pool);
+}
+
+// take over the ldrs & blocks of a freshly parsed set
+void
+Ldrset::adopt(Ldrset * top)
+{
+  TRACE_SPAN("Ldrset::merge");
+  std::unique_ptr<Ldrset> owner(top);
+  top->applyNumPolicy(_policy);
+  if (_dict)
+    top->encode(_dict);
+  if (_pool)
+    top->intern(_pool);
+  c_ldrs.add(top->_ldrs->size());
+  for (auto & block : top->_blocks)
+    c_ldrs.add(block->size());
+  // newly loaded ldrs override existing ldrs.  only pointers are copied,
+  // and nothing at all into an empty set
+  if (_ldrs->empty())
+    _ldrs = std::move(top->_ldrs);
+  else {
+    LdrMap & merged = ldrs();
+    for (auto & it : *top->_ldrs)
+      merged[it.first] = it.second;
+  }
   // these are just pointers, so nothing will be overridden, just combined. maybe should
   // someday fix (todo) so that blocks with same TITLE get combined.
-  _blocks.insert(_blocks.end(), jcamp_topnode->_blocks.begin(), jcamp_topnode->_blocks.end());
-  delete jcamp_topnode;
-  jcamp_topnode = NULL;
+  _blocks.insert(_blocks.end(), top->_blocks.begin(), top->_blocks.end());
   validate();
 }
 
 void
 Ldrset::clear()
 {
-  _ldrs.clear();
+  _ldrs = std::make_shared<LdrMap>();
   _blocks.clear();
 }
 
@@ -485,14 +988,25 @@ void
 Ldrset::addLdr(const string & label, const Ldr & ldr)
 {
   if (DEBUG) INFO("addingLdr '" << label << "' " << ldr << "\n");
-  _ldrs.emplace(label, ldr).first->second.setLabel(label);
+  auto added = ldrs().emplace(label, std::shared_ptr<const Ldr>());
+  if (added.second)
+    added.first->second = std::make_shared<Ldr>(ldr);
+  this->ldr(added.first).setLabel(label);
 }
 
 void
 Ldrset::addLdr(const Ldr & ldr)
 {
   if (DEBUG) INFO("addingLdr '" << ldr.label() << "' " << ldr << "\n");
-  _ldrs.emplace(ldr.label(), ldr);
+  ldrs().emplace(ldr.label(), std::make_shared<Ldr>(ldr));
+}
+
+void
+Ldrset::addLdr(Ldr * ldr)
+{
+  std::shared_ptr<const Ldr> owned(ldr);
+  if (DEBUG) INFO("addingLdr '" << ldr->label() << "' " << *ldr << "\n");
+  ldrs().emplace(ldr->label(), owned);
 }
 
 void
@@ -506,23 +1020,55 @@ Ldrset::addBlock(Ldrset * ldrset)
 void
 Ldrset::deleteLdr(const string & label)
 {
-  _ldrs.erase(label);
+  ldrs().erase(label);
 }
 
 Ldr &
 Ldrset::getLdr(const string & label)
 {
-  if (!_ldrs.count(label))
+  c_lookups.add();
+  auto it = ldrs().find(label);
+  if (it == _ldrs->end()) {
+    c_missed.add();
     throw std::out_of_range("getLdr no such label:" + label);
-  return _ldrs.at(label);
+  }
+  return ldr(it);
 }
 
 const Ldr &
 Ldrset::getLdr(const string & label) const
 {
-  if (!_ldrs.count(label))
+  c_lookups.add();
+  auto it = _ldrs->find(label);
+  if (it == _ldrs->end()) {
+    c_missed.add();
     throw std::out_of_range("getLdr no such label:" + label);
-  return _ldrs.at(label);
+  }
+  return *it->second;
+}
+
+const Ldr *
+Ldrset::findLdr(const Label & label) const
+{
+  c_lookups.add();
+  auto it = _ldrs->find(label);
+  if (it == _ldrs->end()) {
+    c_missed.add();
+    return NULL;
+  }
+  return it->second.get();
+}
+
+std::shared_ptr<const Ldr>
+Ldrset::shareLdr(const string & label) const
+{
+  c_lookups.add();
+  auto it = _ldrs->find(label);
+  if (it == _ldrs->end()) {
+    c_missed.add();
+    throw std::out_of_range("shareLdr no such label:" + label);
+  }
+  return it->second;
 }
 
 void
@@ -535,31 +1081,43 @@ Ldrset::validate() const
 bool
 Ldrset::labelExists(const string & label) const
 {
-  return _ldrs.count(label) > 0;
+  return _ldrs->count(label) > 0;
 }
 
 string
 Ldrset::getString(const string & label, size_t idx) const
 {
-  if (!_ldrs.count(label)) {
+  if (!_ldrs->count(label)) {
     throw std::out_of_range("Ldrset::getString no such label: '" + label + "'");
   }
-  return _ldrs.at(label).str(idx);
+  return _ldrs->at(label)->str(idx);
 }
 
 real_t
 Ldrset::getDouble(const string & label, size_t idx) const
 {
-  if (!_ldrs.count(label)) {
+  if (!_ldrs->count(label)) {
     throw std::out_of_range("Ldrset::getDouble no such label: '" + label + "'");
   }
-  return _ldrs.at(label).num(idx);
+  return _ldrs->at(label)->num(idx);
 }
 
+template <typename T>
+T
+Ldrset::getNum(const string & label, size_t idx) const
+{
+  auto it = _ldrs->find(label);
+  if (it == _ldrs->end())
+    throw std::out_of_range("Ldrset::getNum no such label: '" + label + "'");
+  return it->second->num<T>(idx);
+}
+template double Ldrset::getNum<double>(const string & label, size_t idx) const;
+template float Ldrset::getNum<float>(const string & label, size_t idx) const;
+
 void
 Ldrset::newEmpty(const string & label)
 {
-  if (_ldrs.count(label)) {
+  if (_ldrs->count(label)) {
     return; //! \todo comment this out -- be less tolerant
     throw std::out_of_range("Ldrset::newEmpty label exitst: '" + label + "'");
   }
@@ -569,28 +1127,28 @@ Ldrset::newEmpty(const string & label)
 void
 Ldrset::setString(const string & label, const string & str, size_t idx, bool create)
 {
-  if (!_ldrs.count(label)) {
+  if (!_ldrs->count(label)) {
     if (create)
       newEmpty(label);
     else {
       throw std::out_of_range("Ldrset::setString no such label: '" + label + "'");
     }
   }
-  _ldrs.at(label).setStr(str, idx);
+  ldr(ldrs().find(label)).setStr(str, idx);
 }
 
 void
 Ldrset::setDouble(const string & label, real_t val, size_t idx, bool create)
 {
   //INFO("setDouble(" << label << "[" << idx << "] = " << val << ")\n");
-  if (!_ldrs.count(label)) {
+  if (!_ldrs->count(label)) {
     if (create)
       newEmpty(label);
     else {
       throw std::out_of_range("Ldrset::setDouble no such label: '" + label + "'");
     }
   }
-  _ldrs.at(label).setNum(val, idx);
+  ldr(ldrs().find(label)).setNum(val, idx);
 }
 
 // retrieve a sub-set of LDRs in the particular block
@@ -610,51 +1168,12 @@ std::set<string>
 Ldrset::getLabels() const
 {
   std::set<string> labels;
-  for (auto & it : _ldrs)
-    labels.insert(it.second.label());
+  for (auto & it : *_ldrs)
+    labels.insert(it.second->label());
   return labels;
 }
 
 #ifdef JCAMP_TO_JSON
-//
-// Ldr::Record
-//
-json Ldr::Record::to_json() const
-{
-  json jj;
-  switch (_type) {
-  case RECORD_TEXT:
-  case RECORD_STRING:
-  case RECORD_QSTRING:
-    jj = _str;
-    break;
-  case RECORD_NUMERIC:
-    jj = _num;
-    break;
-  case RECORD_GROUP:
-    jj = _ldr->to_json();
-    break;
-  case RECORD_UNSET:
-    jj = {};
-  }
-  return jj;
-}
-
-void from_json(const json & jj, Ldr::Record & record)
-{
-  if (jj.is_string())
-    record = Ldr::Record(jj.get<string>(), true);
-  else if (jj.is_number())
-    record = Ldr::Record(jj.get<real_t>());
-  else if (jj.is_array()) {
-    Ldr * ldr = new Ldr();
-    from_json(jj, *ldr);
-    record = Ldr::Record(ldr);
-  }
-  else
-    ERROR("Unable to convert JSON to Record: " << jj.dump() << "\n");
-}
-
 //
 // Ldr - convert an Ldr/Ldrset to json
 //
@@ -663,8 +1182,23 @@ json Ldr::to_json() const
   json jj = json::object();
   jj["label"] = label();
   json data;
-  for (auto & record : _data) {
-    json rec = record.to_json();
+  for (size_t ii = 0; ii < _data.size(); ii++) {
+    json rec;
+    switch (_data[ii]._type) {
+    case RECORD_TEXT:
+    case RECORD_STRING:
+    case RECORD_QSTRING:
+      rec = str(ii);
+      break;
+    case RECORD_NUMERIC:
+      rec = _float ? (double)_fnum[ii] : _num[ii];
+      break;
+    case RECORD_GROUP:
+      rec = _data[ii]._ldr->to_json();
+      break;
+    case RECORD_UNSET:
+      rec = {};
+    }
     data.push_back(rec);
   }
   jj["data"] = data;
@@ -678,9 +1212,22 @@ json Ldr::to_json() const
 void from_json(const json & jj, Ldr & ldr)
 {
   ldr._data.clear();
+  ldr._num.clear();
+  ldr._fnum.clear();
+  ldr._float = false;
+  ldr._nonnum = 0;
   for (auto & elem : jj["data"]) {
-    Ldr::Record r = elem;
-    ldr._data.push_back(r);
+    if (elem.is_string())
+      ldr.appendStr(elem.get<string>(), true);
+    else if (elem.is_number())
+      ldr.appendNum(elem.get<real_t>());
+    else if (elem.is_array()) {
+      Ldr * group = new Ldr();
+      from_json(elem, *group);
+      ldr.appendGroup(group);
+    }
+    else
+      ERROR("Unable to convert JSON to Record: " << elem.dump() << "\n");
   }
   ldr._label = jj["label"];
   if (jj.count("shape"))
@@ -694,9 +1241,10 @@ void from_json(const json & jj, Ldr & ldr)
 //
 json Ldrset::to_json() const
 {
+  TRACE_SPAN("Ldrset::to_json");
   json jj = json::array();
-  for (auto & ldr : _ldrs) {
-    json jldr = ldr.second.to_json();
+  for (auto & ldr : *_ldrs) {
+    json jldr = ldr.second->to_json();
     jj.push_back(jldr);
   }
   if (getBlockCount()) {
@@ -745,54 +1293,275 @@ void from_json(const json & jj, Ldrset & ldrset)
 #endif // JCAMP_TO_JSON
 
 #ifdef JCAMPDX_MAIN
-#define CXXOPTS_NO_RTTI
-#include "cxxopts.hpp"
-#include "cio.hpp"
-#ifdef CIO
-using cio::cout;
-#else
+//
+// g++ -std=c++11 -O2 -pthread -DJCAMPDX_MAIN -o jcampdx jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+//
+// jcampdx [-t threads] [-n slowest] [-a] [-v] [-c] [-p] [-j] path...
+//   parses every file given, every file under each directory given, and
+//   every match of each quoted glob, on a thread pool.  prints the files
+//   that failed and a summary: counts, throughput, parse time percentiles
+//   and the slowest files.  exits 1 if anything failed.
+//   -t  at most this many threads (default $BRUKITCHEN_THREADS or all cores)
+//   -n  how many of the slowest files to list (10)
+//   -a  in directories, parse every file, not only those saying JCAMP-DX
+//       in their first 16 KB (which are the only ones read whole)
+//   -v  a line for every file: time, size, LDRs
+//   -c  print the event counters (counters.hpp) at the end
+//   -p  print each parsed set, -j as json
+//
+//   BRUKITCHEN_TRACE=trace.json records where the time goes (trace.hpp)
+//
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "parallel.hpp"
 using std::cout;
-#endif
 
-int main(int argc, char *argv[])
+std::atomic<DebugLevel> g_debug_level(LEVEL_ERROR);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
 {
-  cxxopts::Options options(argv[0], "jcampdx data file utility");
-  options.add_options()
-    ("f,file",          "jcamp file to read",
-     cxxopts::value<std::vector<string> >()->default_value({"/dev/stdin"}))
-    ("J,jfile",         "JSON file to read",
-     cxxopts::value<std::vector<string> >()->default_value({"/dev/stdin"}))
-    ("s,se",            "something else",
-     cxxopts::value<std::vector<string> >()->default_value({"/dev/stdin"}))
-    ("h,help",          "print help message")
-    ("j,json",          "print as JSON")
-    ("v,verbose",       "be verbose")
-    ;
-  options.parse(argc, argv);
-  options.parse_positional("file");
-
-  if (options.count("help")) {
-    cout << options.help();
-    exit(0);
-  }
-
-  for (auto & filename : options["file"].as<std::vector<string> >() ) {
-    try {
-      Ldrset jc(filename);
-      if (DEBUG) {
-        cout << "done:\n";
-        cout << jc;
+  std::cerr << location << ":" << str << "\n";
+}
+
+struct CorpusFile
+{
+  CorpusFile(const string & name, bool found)
+    : path(name), walked(found), skipped(false), parsed(false), bytes(0), seconds(0), ldrs(0) {}
+  string path;
+  bool walked;      //!< found in a directory, skip it if it isn't jcamp-dx
+  bool skipped;
+  bool parsed;      //!< got as far as the parser, ok or not
+  size_t bytes;
+  double seconds;   //!< parsing, not reading
+  size_t ldrs;
+  string error;
+  std::unique_ptr<Ldrset> ldrset;  //!< only kept for -p
+};
+
+static size_t
+count_ldrs(Ldrset & ldrs)
+{
+  size_t count = ldrs.size();
+  for (size_t bb = 0; bb < ldrs.getBlockCount(); bb++)
+    count += count_ldrs(*ldrs.getBlock(bb));
+  return count;
+}
+
+// every file under 'dir', following links to files but not to directories
+static void
+walk(const string & dir, std::vector<CorpusFile> & files)
+{
+  DIR * dd = opendir(dir.c_str());
+  if (!dd) {
+    files.emplace_back(dir, false);
+    files.back().error = "unable to open directory";
+    return;
+  }
+  std::vector<string> names;
+  while (struct dirent * ent = readdir(dd))
+    if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, ".."))
+      names.push_back(ent->d_name);
+  closedir(dd);
+  std::sort(names.begin(), names.end());
+  for (auto & name : names) {
+    string path = dir + "/" + name;
+    struct stat st;
+    if (lstat(path.c_str(), &st))
+      continue;
+    if (S_ISDIR(st.st_mode))
+      walk(path, files);
+    else if (S_ISREG(st.st_mode) || (S_ISLNK(st.st_mode) && !stat(path.c_str(), &st) && S_ISREG(st.st_mode)))
+      files.emplace_back(path, true);
+  }
+}
+
+static void
+add_path(const string & path, std::vector<CorpusFile> & files)
+{
+  struct stat st;
+  if (!stat(path.c_str(), &st)) {
+    if (S_ISDIR(st.st_mode))
+      walk(path, files);
+    else
+      files.emplace_back(path, false);
+    return;
+  }
+  glob_t gl;
+  if (path.find_first_of("*?[") != string::npos && !glob(path.c_str(), 0, NULL, &gl)) {
+    for (size_t ii = 0; ii < gl.gl_pathc; ii++)
+      add_path(gl.gl_pathv[ii], files);
+    globfree(&gl);
+    return;
+  }
+  files.emplace_back(path, false);
+  files.back().error = "no such file";
+}
+
+// how much of a walked file is looked at for ##JCAMP-DX= (or ##JCAMPDX=)
+// before it's read whole, so fid/ser/2dseq in a data tree aren't
+static const size_t g_sniff_bytes = 16384;
+
+static void
+parse_file(CorpusFile & file, bool all, bool keep)
+{
+  if (!file.error.empty())
+    return;
+  string jdx;
+  {
+    TRACE_SPAN("read", file.path);
+    std::ifstream in(file.path.c_str(), std::ios::binary);
+    if (!in) {
+      file.error = "unable to read";
+      return;
+    }
+    if (file.walked && !all) {
+      jdx.resize(g_sniff_bytes);
+      in.read(&jdx[0], jdx.size());
+      jdx.resize(in.gcount());
+      if (jdx.find("JCAMP-DX") == string::npos && jdx.find("JCAMPDX") == string::npos) {
+        file.skipped = true;
+        return;
       }
-      if (options.count("json")) {
-        json jj = jc.to_json();
-        cout << jj.dump(2) << "\n";
+    }
+    stringstream rest;
+    if (in.peek() != std::char_traits<char>::eof()) {
+      rest << in.rdbuf();
+      if (!in) {
+        file.error = "unable to read";
+        return;
       }
-      return 0;
+      jdx += rest.str();
     }
-    catch (const std::exception & ex) {
-      cout << "failed: " << ex.what() << "\n";
-      return -1;
+  }
+  file.bytes = jdx.size();
+  file.parsed = true;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    std::unique_ptr<Ldrset> ldrs(new Ldrset());
+    ldrs->loadString(jdx, file.path);
+    file.ldrs = count_ldrs(*ldrs);
+    if (keep)
+      file.ldrset = std::move(ldrs);
+  }
+  catch (const std::exception & ex) {
+    file.error = ex.what();
+    std::replace(file.error.begin(), file.error.end(), '\n', ' ');
+  }
+  file.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void
+print_file(ostream & out, const CorpusFile & file)
+{
+  char line[96];
+  snprintf(line, sizeof(line), "%10.3f ms %10zu B %7zu LDRs  ", file.seconds * 1e3, file.bytes, file.ldrs);
+  out << line << file.path << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned nthreads = 0;
+  size_t nslowest = 10;
+  bool all = false, verbose = false, counters = false, print = false, asjson = false;
+  std::vector<CorpusFile> files;
+  for (int ii = 1; ii < argc; ii++) {
+    string arg = argv[ii];
+    if (arg == "-t" && ii + 1 < argc)
+      nthreads = (unsigned)atoi(argv[++ii]);
+    else if (arg == "-n" && ii + 1 < argc)
+      nslowest = (size_t)atoi(argv[++ii]);
+    else if (arg == "-a")
+      all = true;
+    else if (arg == "-v")
+      verbose = true;
+    else if (arg == "-c")
+      counters = true;
+    else if (arg == "-p")
+      print = true;
+    else if (arg == "-j")
+      print = asjson = true;
+    else if (arg[0] == '-' && arg.size() > 1) {
+      std::cerr << "usage: " << argv[0] << " [-t threads] [-n slowest] [-a] [-v] [-c] [-p] [-j] path...\n";
+      return 1;
+    }
+    else
+      add_path(arg, files);
+  }
+  if (files.empty())
+    add_path("/dev/stdin", files);
+#ifndef JCAMP_TO_JSON
+  if (asjson) {
+    std::cerr << argv[0] << ": built without JCAMP_TO_JSON\n";
+    return 1;
+  }
+#endif
+
+  auto start = std::chrono::steady_clock::now();
+  parallel_for(files.size(), [&](size_t ii) { parse_file(files[ii], all, print); }, nthreads);
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // with -p the sets go to stdout and the summary to stderr
+  ostream & out = print ? std::cerr : cout;
+  std::vector<const CorpusFile *> parsed;
+  size_t nfailed = 0, nskipped = 0, nbytes = 0, nldrs = 0;
+  double cpu = 0;
+  for (auto & file : files) {
+    if (file.skipped) {
+      nskipped++;
+      continue;
+    }
+    if (!file.error.empty()) {
+      nfailed++;
+      out << "failed: " << file.path << ": " << file.error << "\n";
+    }
+    else if (verbose)
+      print_file(out, file);
+    if (file.ldrset) {
+      if (asjson) {
+#ifdef JCAMP_TO_JSON
+        cout << file.ldrset->to_json().dump(2) << "\n";
+#endif
+      }
+      else
+        cout << *file.ldrset;
+    }
+    if (!file.parsed)
+      continue;
+    parsed.push_back(&file);
+    nbytes += file.bytes;
+    nldrs += file.ldrs;
+    cpu += file.seconds;
+  }
+
+  char line[160];
+  snprintf(line, sizeof(line), "%zu files: %zu ok, %zu failed, %zu skipped (not jcamp-dx)\n",
+           files.size(), files.size() - nfailed - nskipped, nfailed, nskipped);
+  out << line;
+  snprintf(line, sizeof(line), "%.2f MB, %zu LDRs in %.3f s (%.3f s parsing, %.1f MB/s, %.0f LDRs/s per thread)\n",
+           nbytes / 1e6, nldrs, wall, cpu, cpu > 0 ? nbytes / 1e6 / cpu : 0., cpu > 0 ? nldrs / cpu : 0.);
+  out << line;
+  if (counters)
+    for (auto & counter : Counter::snapshot()) {
+      snprintf(line, sizeof(line), "%-28s %14llu\n", counter.first.c_str(), (unsigned long long)counter.second);
+      out << line;
     }
+  if (parsed.empty())
+    return nfailed ? 1 : 0;
+
+  std::sort(parsed.begin(), parsed.end(),
+            [](const CorpusFile * aa, const CorpusFile * bb) { return aa->seconds > bb->seconds; });
+  auto pct = [&](double pp) { return parsed[(size_t)((1 - pp) * (parsed.size() - 1))]->seconds * 1e3; };
+  snprintf(line, sizeof(line), "parse ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+           pct(.5), pct(.9), pct(.99), pct(1));
+  out << line;
+  if (nslowest) {
+    out << "slowest:\n";
+    for (size_t ii = 0; ii < nslowest && ii < parsed.size(); ii++)
+      print_file(out, *parsed[ii]);
   }
+  return nfailed ? 1 : 0;
 }
 #endif
@@ -57,14 +57,13 @@ using std::string;
 #include <map>
 #include <set>
 #include <vector>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#ifndef real_t
-#ifdef REAL_FLOAT
-typedef float real_t;
-#else
+#include <mutex>
+#include <unordered_map>
+//! what numbers are parsed into, how they're kept is up to the NumPolicy
 typedef double real_t;
-#endif
-#endif
 
 #ifdef JCAMP_TO_JSON
 #include "json/src/json.hpp"
@@ -82,11 +81,51 @@ enum record_type {
 
 class Ldr;
 
+//! how a load stores the numbers of each Ldr
+//
+// with float_tables, numeric arrays of min_table or more values are kept as
+// float, halving their storage and what a bulk export moves.  scalars and
+// short arrays (BF1, SFO1, TD, ...) always stay double.
+struct NumPolicy {
+  NumPolicy(bool floats = false, size_t min = 64) : float_tables(floats), min_table(min) {}
+  bool float_tables;
+  size_t min_table;
+};
+
 //! string to label
 struct Label : public string {
   Label(string name);
 };
 
+//! the short strings of a load session (enum values like Yes/No, coil
+//! names...) kept once each, as small codes.  several threads can add to
+//! and read one dictionary at once
+class LdrDict
+{
+public:
+  enum { MAXLEN = 64 };   //!< longer strings don't get a code
+
+  LdrDict();
+  ~LdrDict();
+  //! the code of 'str', added if it's new, or 0 if the dictionary is full
+  uint32_t code(const string & str);
+  //! the code of 'str', 0 if it isn't in the dictionary
+  uint32_t find(const string & str) const;
+  //! the string of 'code', good for the dictionary's life
+  const string & str(uint32_t code) const;
+  size_t size() const;
+
+private:
+  LdrDict(const LdrDict &) = delete;
+  LdrDict & operator=(const LdrDict &) = delete;
+
+  enum { CHUNK = 1024, CHUNKS = 4096 };
+  mutable std::mutex _mutex;
+  std::unordered_map<string, uint32_t> _codes;   //!< under _mutex
+  std::atomic<string *> _chunks[CHUNKS];          //!< the strings, by code
+  uint32_t _next;                                 //!< under _mutex
+};
+
 class Ldr {
 public:
   Ldr();
@@ -96,13 +135,32 @@ public:
 
   size_t size() const;
   std::vector<int> shape() const;
+  //! declared array dimensions, slowest first, or {size()} if there are none
+  std::vector<int> dims() const;
   string label() const;
 
   // get values
   const string & str(size_t idx = 0) const;
-  const real_t & num(size_t idx = 0) const;
+  //! record 'idx''s code in the set's LdrDict, 0 if it hasn't one.  in
+  //! sets sharing a dictionary, equal codes are equal strings
+  uint32_t code(size_t idx = 0) const;
+  //! number 'idx' as a T (float or double), however it's stored
+  template <typename T = double> T num(size_t idx = 0) const;
   record_type type(size_t idx = 0) const;
+  const Ldr & group(size_t idx = 0) const;
+  //! all of the numeric values, contiguous, one per record (NaN for
+  //! non-numbers), or NULL if they aren't stored as T
+  template <typename T = double> const T * nums() const;
+  //! copy up to 'n' numbers into 'out' converted to T, returns size()
+  template <typename T> size_t copyNums(T * out, size_t n) const;
+  //! true if every record is a number
+  bool isNumeric() const;
+  //! true if the numbers are stored as float rather than double
+  bool floatStorage() const;
+  //! store the numbers as float or double, converting what's there
+  void setFloatStorage(bool floats);
   void setStr(const string & str, size_t idx = 0);
+  //! kept as float if the numbers are
   void setNum(real_t val, size_t idx = 0);
 
   void setLabel(const string & label);
@@ -111,7 +169,13 @@ public:
 
   void appendStr(const string & str, bool quoted = false);
   void appendNum(real_t val);
-  void appendGroup(Ldr * group);
+  void appendGroup(Ldr * group);  //!< takes ownership of 'group'
+
+  //! same label, records, numbers (bit for bit) and shape
+  bool operator==(const Ldr & other) const;
+  bool operator!=(const Ldr & other) const { return !(*this == other); }
+  //! of what operator== compares
+  size_t hash() const;
 
 private:
   class Record {
@@ -119,12 +183,10 @@ private:
     Record();
     Record(const string & str, bool quoted = false);
     Record(real_t val);
-    Record(Ldr * ldr);
+    Record(Ldr * ldr);  //!< takes ownership of 'ldr'
 
-    const real_t & num() const;
     const string & str() const;
     record_type type() const;
-    void setNum(real_t val);
     void setStr(const string & str, bool quoted = false);
     const Ldr & group() const;
     void setType(record_type type);
@@ -132,35 +194,80 @@ private:
     friend ostream & operator <<(ostream & out, Ldr::Record const & l);
     friend ostream & operator <<(ostream & out, Ldr const & l);
     friend Ldr;
-#ifdef JCAMP_TO_JSON
-    json to_json() const;
-#endif
   private:
     record_type _type;
+    uint32_t _code;     //!< in the Ldr's _dict, then _str is empty
     string _str;
-    real_t _num;
-    Ldr * _ldr;
+    std::shared_ptr<const Ldr> _ldr;  //!< shared by copies of the record
   };
 
 public:
   friend Record;
+  friend class Ldrset;  //!< encode()s what it loads
+  friend class LdrPool; //!< marks what it holds
   friend ostream & operator <<(ostream & out, Ldr const & l);
   friend ostream & operator <<(ostream & out, Ldr::Record const & l);
 #ifdef JCAMP_TO_JSON
   json to_json() const;
-  friend void from_json(const json & jj, Ldr::Record & ldr);
   friend void from_json(const json & jj, Ldr & ldr);
 #endif
 
 private:
+  void grow(size_t idx);
+  void pushNum(real_t val);
+  const std::vector<double> & values(const double *) const { return _num; }
+  const std::vector<float> & values(const float *) const { return _fnum; }
+  void counted_append();
+  void retype(size_t idx, record_type type);
+  void encode(const std::shared_ptr<LdrDict> & dict);
+
   std::vector<Record> _data;
-  //std::vector<real_t> _num; // special case -- optimize table data .. someday
+  // kept apart from _data so numeric tables are contiguous, one or the other
+  std::vector<double> _num;
+  std::vector<float> _fnum;
+  bool _float;
+  size_t _nonnum;
   string _label;
   std::vector<int> _shape;
   enum shape_type { SHAPE_1D, SHAPE_2D, SHAPE_XYY, SHAPE_XYXY } _shape_type;
+  std::shared_ptr<LdrDict> _dict;   //!< if any record has a code
+  //! set once a pool holds the ldr, so it's never changed in place.  copies
+  //! start out unmarked
+  struct PoolMark {
+    PoolMark() : set(false) {}
+    PoolMark(const PoolMark &) : set(false) {}
+    PoolMark & operator=(const PoolMark &) { return *this; }
+    bool set;
+  } _pooled;
 };
 
-//
+//! ldrs from many sets (ie. every scan of a study), equal ones kept once.
+//! several threads can load into sets sharing a pool
+class LdrPool
+{
+public:
+  //! an ldr in the pool equal to 'ldr', else 'ldr' itself, added
+  std::shared_ptr<const Ldr> intern(const std::shared_ptr<const Ldr> & ldr);
+  //! distinct ldrs still held by some set
+  size_t size() const;
+
+private:
+  enum { SHARDS = 16 };
+  struct Shard {
+    Shard() : added(0) {}
+    mutable std::mutex mutex;
+    std::unordered_multimap<size_t, std::weak_ptr<const Ldr> > ldrs;
+    size_t added;   //!< since the last sweep for expired entries
+  };
+  Shard _shards[SHARDS];
+};
+
+//! copies share their ldrs until one of them changes, then just the
+//! changed ldr is copied, as is a pooled one the first time.  a reference
+//! from the non-const getLdr() is to this set's own ldr, until the set is
+//! next copied.  one from the const getLdr() or findLdr() lasts until the
+//! next non-const access of that label, which may swap in a copy; hold
+//! shareLdr() to keep the ldr past that.
 class Ldrset
 {
 public:
@@ -171,21 +278,43 @@ public:
 
   void loadFile(const string & filename);
   void loadString(const string & jdxstring, const string & nametag="string");
+  //! how the following loads store numbers
+  void setNumPolicy(const NumPolicy & policy);
+  const NumPolicy & numPolicy() const;
+  //! keep ldrs equal to ones already in 'pool' just once, from the
+  //! following loads on.  NULL to stop
+  void setPool(const std::shared_ptr<LdrPool> & pool);
+  //! true if 'label' is the very same ldr in both sets, not just equal
+  bool shares(const Ldrset & other, const string & label) const;
+  //! keep the short strings of the following loads in 'dict', as codes,
+  //! once for all the sets using it.  NULL to stop
+  void setDict(const std::shared_ptr<LdrDict> & dict);
+  const std::shared_ptr<LdrDict> & dict() const;
+  //! the code of 'str' in the set's dictionary, 0 if it hasn't one
+  uint32_t findCode(const string & str) const;
   void clear();
   size_t size() const;
 
   //
   void addLdr(const Ldr & ldr);
   void addLdr(const string & label, const Ldr & ldr);
+  void addLdr(Ldr * ldr);  //!< takes ownership of 'ldr'
   void addBlock(Ldrset * ldrset);
   void deleteLdr(const string & label);
   Ldr & getLdr(const string & label);
   const Ldr & getLdr(const string & label) const;
+  //! NULL if there's no such label, doesn't throw
+  const Ldr * findLdr(const Label & label) const;
+  //! the ldr itself, it outlives any later change to the set (which then
+  //! changes a copy).  throws like getLdr()
+  std::shared_ptr<const Ldr> shareLdr(const string & label) const;
 
   // data retreival
   bool labelExists(const string & label) const;
   string getString(const string & label, size_t idx = 0) const;
   real_t getDouble(const string & label, size_t idx = 0) const;
+  //! getDouble as a float or double
+  template <typename T> T getNum(const string & label, size_t idx = 0) const;
 
   void newEmpty(const string & label);
   void setString(const string & label, const string & str, size_t idx = 0, bool create = false);
@@ -200,16 +329,31 @@ public:
   json to_json() const;
 #endif
 
-  // stuff for the parser
-  Ldrset * jcamp_topnode;
-  string _curfilename;
   std::set<string> getLabels() const;
 
 private:
   void validate() const;
+  void adopt(Ldrset * top);
+  void applyNumPolicy(const NumPolicy & policy);
+  void intern(const std::shared_ptr<LdrPool> & pool);
+  void encode(const std::shared_ptr<LdrDict> & dict);
 
-  std::map<Label, Ldr> _ldrs;
+  typedef std::map<Label, std::shared_ptr<const Ldr> > LdrMap;
+  LdrMap & ldrs();                          //!< the map, unshared first
+  Ldr & ldr(LdrMap::iterator it);           //!< the ldr, unshared first
+
+  std::shared_ptr<LdrMap> _ldrs;            //!< shared by copies of the set
   std::vector<std::shared_ptr<Ldrset> > _blocks;
+  NumPolicy _policy;
+  std::shared_ptr<LdrPool> _pool;
+  std::shared_ptr<LdrDict> _dict;
+};
+
+//! scratch state of one parse, so different files can be parsed at once
+struct JcampParse {
+  JcampParse(const string & name) : topnode(NULL), filename(name) {}
+  Ldrset * topnode;   //!< what the parser built
+  string filename;    //!< for error locations
 };
 
 #ifdef JCAMP_TO_JSON
@@ -217,7 +361,6 @@ private:
 using json = nlohmann::json;
 
 // convert json into an Ldr/Ldrset
-void from_json(const json & jj, Ldr::Record & ldr);
 void from_json(const json & jj, Ldr & ldr);
 void from_json(const json & jj, Ldrset & ldrset);
 #endif // JCAMP_TO_JSON
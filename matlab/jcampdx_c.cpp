@@ -0,0 +1,335 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// C interface to the JCAMP-DX reader
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Linux: g++ -std=c++11 -O2 -fPIC -shared -o libjcampdx.so jcampdx_c.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+//
+// define JDX_EXTERNAL_DEBUG if the program linking this defines its own
+// g_debug_level & DebugFunc
+//
+#include <cmath>
+#include <cstring>
+#include "jcampdx.hpp"
+#include "jcampdx_c.h"
+
+struct jdx_ldrset {
+  Ldrset ldrs;
+  std::vector<string> labels;
+  std::vector<const Ldr *> ldrs_at;
+};
+
+static_assert((int)JDX_TEXT == (int)RECORD_TEXT && (int)JDX_UNSET == (int)RECORD_UNSET,
+              "jdx_type out of sync with record_type");
+
+static thread_local string t_last_error;
+
+static const Ldr * ldr_of(const jdx_ldr * ldr) { return reinterpret_cast<const Ldr *>(ldr); }
+static const jdx_ldr * ldr_to(const Ldr * ldr) { return reinterpret_cast<const jdx_ldr *>(ldr); }
+
+#ifndef JDX_EXTERNAL_DEBUG
+std::atomic<DebugLevel> g_debug_level(LEVEL_ERROR);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  std::cerr << location << ":" << str << "\n";
+}
+#endif
+
+// the set changed, redo the label index
+static void
+reindex(jdx_ldrset * set)
+{
+  // the const getLdr, which doesn't unshare
+  const Ldrset & ldrs = set->ldrs;
+  std::set<string> labels = ldrs.getLabels();
+  set->labels.assign(labels.begin(), labels.end());
+  set->ldrs_at.clear();
+  for (auto & label : set->labels)
+    set->ldrs_at.push_back(&ldrs.getLdr(label));
+}
+
+// run 'fn', turning exceptions into -1 & jdx_last_error()
+template <typename FN>
+static int
+guard(FN fn)
+{
+  try {
+    fn();
+    return 0;
+  }
+  catch (const std::exception & ex) {
+    t_last_error = ex.what();
+  }
+  catch (...) {
+    t_last_error = "unknown exception";
+  }
+  return -1;
+}
+
+extern "C" {
+
+int
+jdx_api_version(void)
+{
+  return JDX_API_VERSION;
+}
+
+const char *
+jdx_last_error(void)
+{
+  return t_last_error.c_str();
+}
+
+jdx_ldrset *
+jdx_ldrset_new(void)
+{
+  try {
+    return new jdx_ldrset();
+  }
+  catch (const std::exception & ex) {
+    t_last_error = ex.what();
+    return NULL;
+  }
+}
+
+void
+jdx_ldrset_free(jdx_ldrset * ldrs)
+{
+  delete ldrs;
+}
+
+int
+jdx_ldrset_load_file(jdx_ldrset * ldrs, const char * filename)
+{
+  if (!ldrs || !filename) {
+    t_last_error = "jdx_ldrset_load_file: NULL argument";
+    return -1;
+  }
+  int rc = guard([&] { ldrs->ldrs.loadFile(filename); });
+  guard([&] { reindex(ldrs); });
+  return rc;
+}
+
+int
+jdx_ldrset_load_buffer(jdx_ldrset * ldrs, const char * buf, size_t len, const char * name)
+{
+  if (!ldrs || (!buf && len)) {
+    t_last_error = "jdx_ldrset_load_buffer: NULL argument";
+    return -1;
+  }
+  int rc = guard([&] { ldrs->ldrs.loadString(string(buf, len), name ? name : "buffer"); });
+  guard([&] { reindex(ldrs); });
+  return rc;
+}
+
+int
+jdx_ldrset_float_tables(jdx_ldrset * ldrs, size_t min_table)
+{
+  if (!ldrs) {
+    t_last_error = "jdx_ldrset_float_tables: NULL argument";
+    return -1;
+  }
+  ldrs->ldrs.setNumPolicy(NumPolicy(min_table > 0, min_table));
+  return 0;
+}
+
+int
+jdx_ldrset_share_strings(jdx_ldrset * ldrs, jdx_ldrset * with)
+{
+  if (!ldrs || !with) {
+    t_last_error = "jdx_ldrset_share_strings: NULL argument";
+    return -1;
+  }
+  return guard([&] {
+      if (!with->ldrs.dict())
+        with->ldrs.setDict(std::make_shared<LdrDict>());
+      ldrs->ldrs.setDict(with->ldrs.dict());
+    });
+}
+
+uint32_t
+jdx_ldrset_find_code(const jdx_ldrset * ldrs, const char * str)
+{
+  if (!ldrs || !str)
+    return 0;
+  uint32_t code = 0;
+  guard([&] { code = ldrs->ldrs.findCode(str); });
+  return code;
+}
+
+size_t
+jdx_ldrset_count(const jdx_ldrset * ldrs)
+{
+  return ldrs ? ldrs->labels.size() : 0;
+}
+
+const char *
+jdx_ldrset_label(const jdx_ldrset * ldrs, size_t idx)
+{
+  if (!ldrs || idx >= ldrs->labels.size()) {
+    t_last_error = "jdx_ldrset_label: index out of range";
+    return NULL;
+  }
+  return ldrs->labels[idx].c_str();
+}
+
+const jdx_ldr *
+jdx_ldrset_at(const jdx_ldrset * ldrs, size_t idx)
+{
+  if (!ldrs || idx >= ldrs->ldrs_at.size()) {
+    t_last_error = "jdx_ldrset_at: index out of range";
+    return NULL;
+  }
+  return ldr_to(ldrs->ldrs_at[idx]);
+}
+
+const jdx_ldr *
+jdx_ldrset_find(const jdx_ldrset * ldrs, const char * label)
+{
+  if (!ldrs || !label) {
+    t_last_error = "jdx_ldrset_find: NULL argument";
+    return NULL;
+  }
+  const Ldr * found = NULL;
+  if (guard([&] { found = &ldrs->ldrs.getLdr(label); }))
+    return NULL;
+  return ldr_to(found);
+}
+
+size_t
+jdx_ldr_size(const jdx_ldr * ldr)
+{
+  return ldr ? ldr_of(ldr)->size() : 0;
+}
+
+int
+jdx_ldr_type(const jdx_ldr * ldr, size_t idx)
+{
+  if (!ldr || idx >= ldr_of(ldr)->size())
+    return 0;
+  return (int)ldr_of(ldr)->type(idx);
+}
+
+int
+jdx_ldr_is_numeric(const jdx_ldr * ldr)
+{
+  return ldr && ldr_of(ldr)->isNumeric();
+}
+
+size_t
+jdx_ldr_dims(const jdx_ldr * ldr, size_t * dims, size_t maxdims)
+{
+  if (!ldr)
+    return 0;
+  std::vector<int> dd = ldr_of(ldr)->dims();
+  for (size_t ii = 0; ii < dd.size() && ii < maxdims && dims; ii++)
+    dims[ii] = (size_t)dd[ii];
+  return dd.size();
+}
+
+const double *
+jdx_ldr_data(const jdx_ldr * ldr)
+{
+  if (!ldr)
+    return NULL;
+  if (ldr_of(ldr)->floatStorage()) {
+    t_last_error = "jdx_ldr_data: numbers are stored as float, use jdx_ldr_data_float";
+    return NULL;
+  }
+  return ldr_of(ldr)->nums<double>();
+}
+
+const float *
+jdx_ldr_data_float(const jdx_ldr * ldr)
+{
+  if (!ldr)
+    return NULL;
+  if (!ldr_of(ldr)->floatStorage()) {
+    t_last_error = "jdx_ldr_data_float: numbers are stored as double, use jdx_ldr_data";
+    return NULL;
+  }
+  return ldr_of(ldr)->nums<float>();
+}
+
+int
+jdx_ldr_is_float(const jdx_ldr * ldr)
+{
+  return ldr && ldr_of(ldr)->floatStorage();
+}
+
+double
+jdx_ldr_num(const jdx_ldr * ldr, size_t idx)
+{
+  if (!ldr || idx >= ldr_of(ldr)->size())
+    return NAN;
+  return ldr_of(ldr)->num(idx);
+}
+
+size_t
+jdx_ldr_get_doubles(const jdx_ldr * ldr, double * out, size_t n)
+{
+  if (!ldr)
+    return 0;
+  return ldr_of(ldr)->copyNums(out, n);
+}
+
+size_t
+jdx_ldr_get_floats(const jdx_ldr * ldr, float * out, size_t n)
+{
+  if (!ldr)
+    return 0;
+  return ldr_of(ldr)->copyNums(out, n);
+}
+
+const char *
+jdx_ldr_str(const jdx_ldr * ldr, size_t idx)
+{
+  if (!ldr || idx >= ldr_of(ldr)->size()) {
+    t_last_error = "jdx_ldr_str: index out of range";
+    return NULL;
+  }
+  return ldr_of(ldr)->str(idx).c_str();
+}
+
+uint32_t
+jdx_ldr_code(const jdx_ldr * ldr, size_t idx)
+{
+  if (!ldr || idx >= ldr_of(ldr)->size())
+    return 0;
+  return ldr_of(ldr)->code(idx);
+}
+
+size_t
+jdx_ldr_get_strings(const jdx_ldr * ldr, char * buf, size_t buflen, size_t * offsets)
+{
+  if (!ldr)
+    return 0;
+  const Ldr & ll = *ldr_of(ldr);
+  size_t needed = 0;
+  for (size_t ii = 0; ii < ll.size(); ii++)
+    needed += ll.str(ii).size() + 1;
+  if (!buf || buflen < needed)
+    return needed;
+  char * pos = buf;
+  for (size_t ii = 0; ii < ll.size(); ii++) {
+    const string & str = ll.str(ii);
+    if (offsets)
+      offsets[ii] = (size_t)(pos - buf);
+    memcpy(pos, str.c_str(), str.size() + 1);
+    pos += str.size() + 1;
+  }
+  return needed;
+}
+
+const jdx_ldr *
+jdx_ldr_group(const jdx_ldr * ldr, size_t idx)
+{
+  if (jdx_ldr_type(ldr, idx) != JDX_GROUP) {
+    t_last_error = "jdx_ldr_group: not a group";
+    return NULL;
+  }
+  return ldr_to(&ldr_of(ldr)->group(idx));
+}
+
+} // extern "C"
@@ -0,0 +1,102 @@
+/* -*-  Mode: C; c-basic-offset: 2 -*-
+ *
+ * C interface to the JCAMP-DX reader
+ *
+ * (c)2016 Michael Tesch, tesch1@gmail.com
+ *
+ * A plain C ABI over Ldrset/Ldr for FFI (Julia ccall, ctypes, C programs...)
+ * without going through SWIG or std::string.
+ *
+ * Handles are opaque.  An Ldrset is owned by the caller (jdx_ldrset_new /
+ * jdx_ldrset_free), jdx_ldr pointers and the strings and arrays returned
+ * from them point into it and stay valid until the set is loaded into again
+ * or freed.  Nothing here throws; failing calls return -1 or NULL and
+ * jdx_last_error() says why.  Different handles can be used from different
+ * threads at the same time, one handle can't.
+ */
+#ifndef JCAMPDX_C_H
+#define JCAMPDX_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JDX_API_VERSION 3
+
+typedef struct jdx_ldrset jdx_ldrset;
+typedef struct jdx_ldr jdx_ldr;
+
+/* record types, same values as record_type in jcampdx.hpp */
+enum jdx_type {
+  JDX_TEXT = 1,
+  JDX_STRING,
+  JDX_QSTRING,
+  JDX_NUMERIC,
+  JDX_GROUP,
+  JDX_UNSET
+};
+
+int jdx_api_version(void);
+/* why the last failing call on this thread failed */
+const char * jdx_last_error(void);
+
+jdx_ldrset * jdx_ldrset_new(void);
+void jdx_ldrset_free(jdx_ldrset * ldrs);
+/* parse a file, or 'len' bytes of 'buf', adding to what's already in the set */
+int jdx_ldrset_load_file(jdx_ldrset * ldrs, const char * filename);
+int jdx_ldrset_load_buffer(jdx_ldrset * ldrs, const char * buf, size_t len, const char * name);
+/* loads from now on keep numeric arrays of 'min_table' or more values as
+ * float, 0 keeps everything double (the default).  since version 2 */
+int jdx_ldrset_float_tables(jdx_ldrset * ldrs, size_t min_table);
+/* loads from now on keep short strings (enum values...) as codes in the
+ * dictionary of 'with', made if it hasn't one; equal strings have equal
+ * codes in every set sharing it.  'with' may be 'ldrs'.  since version 3 */
+int jdx_ldrset_share_strings(jdx_ldrset * ldrs, jdx_ldrset * with);
+/* the code of 'str' in the set's dictionary, 0 if it hasn't one */
+uint32_t jdx_ldrset_find_code(const jdx_ldrset * ldrs, const char * str);
+
+/* labels, sorted, for idx in [0, count) */
+size_t jdx_ldrset_count(const jdx_ldrset * ldrs);
+const char * jdx_ldrset_label(const jdx_ldrset * ldrs, size_t idx);
+const jdx_ldr * jdx_ldrset_at(const jdx_ldrset * ldrs, size_t idx);
+/* look up 'label' the way Ldrset::getLdr does, NULL if it isn't there */
+const jdx_ldr * jdx_ldrset_find(const jdx_ldrset * ldrs, const char * label);
+
+size_t jdx_ldr_size(const jdx_ldr * ldr);
+/* type of record 'idx', 0 if out of range */
+int jdx_ldr_type(const jdx_ldr * ldr, size_t idx);
+/* 1 if every record is a number */
+int jdx_ldr_is_numeric(const jdx_ldr * ldr);
+/* declared dims, slowest first, up to 'maxdims' of them; returns how many there are */
+size_t jdx_ldr_dims(const jdx_ldr * ldr, size_t * dims, size_t maxdims);
+
+/* the numbers, contiguous, one per record (NaN for non-numbers), no copy.
+ * NULL if they're stored as float, then jdx_ldr_data_float has them. */
+const double * jdx_ldr_data(const jdx_ldr * ldr);
+const float * jdx_ldr_data_float(const jdx_ldr * ldr);
+/* 1 if the numbers are stored as float (see jdx_ldrset_float_tables) */
+int jdx_ldr_is_float(const jdx_ldr * ldr);
+/* number 'idx', NaN if it's out of range or not a number */
+double jdx_ldr_num(const jdx_ldr * ldr, size_t idx);
+/* copy up to 'n' numbers into 'out' as doubles, returns size */
+size_t jdx_ldr_get_doubles(const jdx_ldr * ldr, double * out, size_t n);
+size_t jdx_ldr_get_floats(const jdx_ldr * ldr, float * out, size_t n);
+/* the text of record 'idx', NUL terminated, no copy.  NULL if out of range */
+const char * jdx_ldr_str(const jdx_ldr * ldr, size_t idx);
+/* the code of record 'idx' (see jdx_ldrset_share_strings), 0 if it has none */
+uint32_t jdx_ldr_code(const jdx_ldr * ldr, size_t idx);
+/* copy every record's text into 'buf' NUL separated, their offsets into
+ * 'offsets' (size() entries, may be NULL).  copies nothing if 'buflen' is
+ * too small; returns the bytes needed. */
+size_t jdx_ldr_get_strings(const jdx_ldr * ldr, char * buf, size_t buflen, size_t * offsets);
+/* the group in record 'idx', NULL if it isn't one */
+const jdx_ldr * jdx_ldr_group(const jdx_ldr * ldr, size_t idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JCAMPDX_C_H */
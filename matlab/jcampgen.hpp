@@ -0,0 +1,217 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// deterministic generator of synthetic jcamp-dx / paravision parameter files
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// The same JcampGenParams and index always give the same bytes, on any
+// platform (the random numbers are a fixed xorshift, not <random>'s
+// implementation-defined distributions), so a corpus can be regenerated
+// instead of being checked in.
+//
+#ifndef JCAMPGEN_HPP
+#define JCAMPGEN_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+struct JcampGenParams
+{
+  uint64_t seed = 1;
+  int labels = 200;        //!< user ($) labels per block
+  int maxlen = 256;        //!< longest array, lengths are spread log-uniformly up to it
+  int depth = 2;           //!< deepest nesting of ( ) groups
+  double strings = 0.3;    //!< fraction of labels that are strings rather than numbers
+  double arrays = 0.4;     //!< fraction of labels that are arrays
+  double groups = 0.1;     //!< fraction of labels that are group arrays
+  int blocks = 1;          //!< >1 writes a ##BLOCKS= link file of titled blocks
+  bool repeats = false;    //!< write runs of equal numbers as @N*(x)
+};
+
+class JcampGen
+{
+public:
+  JcampGen(const JcampGenParams & params) : _params(params), _state(0) {}
+
+  //! file number 'index' of the corpus
+  std::string file(int index)
+  {
+    seed(index);
+    std::ostringstream out;
+    if (_params.blocks > 1) {
+      out << "##TITLE= synthetic link " << index << "\n"
+          << "##JCAMPDX= 4.24\n"
+          << "##BLOCKS= " << _params.blocks << "\n";
+      for (int bb = 0; bb < _params.blocks; bb++)
+        block(out, index, bb);
+      out << "##END=\n";
+    }
+    else
+      block(out, index, 0);
+    return out.str();
+  }
+
+private:
+  void seed(int index)
+  {
+    _state = _params.seed * 0x9E3779B97F4A7C15ull + (uint64_t)index + 1;
+    for (int ii = 0; ii < 4; ii++)
+      next();
+  }
+
+  // xorshift64*
+  uint64_t next()
+  {
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    return _state * 0x2545F4914F6CDD1Dull;
+  }
+
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+  int below(int nn) { return nn > 0 ? (int)(next() % (uint64_t)nn) : 0; }
+  bool chance(double pp) { return uniform() < pp; }
+
+  int length()
+  {
+    int len = 1;
+    while (len < _params.maxlen && chance(0.8))
+      len *= 2;
+    return len > _params.maxlen ? _params.maxlen : len;
+  }
+
+  std::string number()
+  {
+    char buf[32];
+    switch (below(4)) {
+    case 0: snprintf(buf, sizeof(buf), "%d", below(2000) - 1000); break;
+    case 1: snprintf(buf, sizeof(buf), "%.6g", uniform() * 1000); break;
+    case 2: snprintf(buf, sizeof(buf), "%.10g", (uniform() - 0.5) * 1e-3); break;
+    default: snprintf(buf, sizeof(buf), "%.4e", (uniform() - 0.5) * 1e12); break;
+    }
+    return buf;
+  }
+
+  std::string word()
+  {
+    static const char * words[] = {
+      "Yes", "No", "On", "Off", "Standard", "User_Defined", "Cartesian",
+      "Linear", "Sinc3", "Gauss", "ParaVision", "Mouse", "Water", "CW",
+    };
+    return words[below(sizeof(words) / sizeof(words[0]))];
+  }
+
+  std::string qstring()
+  {
+    std::string str;
+    int nwords = 1 + below(8);
+    for (int ii = 0; ii < nwords; ii++)
+      str += (ii ? " " : "") + word();
+    return "<" + str + ">";
+  }
+
+  // a ( ) group 'depth' levels deep
+  std::string group(int depth)
+  {
+    std::string str = "(";
+    int nn = 1 + below(4);
+    for (int ii = 0; ii < nn; ii++) {
+      if (ii)
+        str += ", ";
+      if (depth > 1 && chance(0.3))
+        str += group(depth - 1);
+      else if (chance(0.4))
+        str += qstring();
+      else if (chance(0.3))
+        str += word();
+      else
+        str += number();
+    }
+    return str + ")";
+  }
+
+  // paravision wraps at 80 columns
+  static void wrap(std::ostream & out, const std::string & item, size_t & col)
+  {
+    if (col && col + 1 + item.size() > 80) {
+      out << "\n";
+      col = 0;
+    }
+    else if (col) {
+      out << " ";
+      col++;
+    }
+    out << item;
+    col += item.size();
+  }
+
+  void label(std::ostream & out, int nn)
+  {
+    bool array = chance(_params.arrays);
+    bool isgroup = _params.depth > 0 && chance(_params.groups);
+    bool isstring = chance(_params.strings);
+    size_t col = 0;
+
+    if (isgroup) {
+      int len = 1 + below(_params.maxlen < 16 ? _params.maxlen : 16);
+      out << "##$PG" << nn << "= ( " << len << " )\n";
+      for (int ii = 0; ii < len; ii++)
+        wrap(out, group(_params.depth), col);
+    }
+    else if (isstring && array) {
+      // paravision's char arrays: the declared size is the buffer length
+      out << "##$PQ" << nn << "= ( " << 64 * (1 + below(4)) << " )\n" << qstring();
+    }
+    else if (isstring) {
+      out << "##$PS" << nn << "= " << word();
+    }
+    else if (array) {
+      int len = length();
+      bool twod = len >= 4 && chance(0.25);
+      out << "##$PA" << nn << "= ( ";
+      if (twod)
+        out << len / 4 << ", 4";
+      else
+        out << len;
+      out << " )\n";
+      if (twod)
+        len = len / 4 * 4;
+      for (int ii = 0; ii < len; ) {
+        std::string num = number();
+        int run = chance(0.2) ? 1 + below(len - ii) : 1;
+        if (run > 1 && _params.repeats) {
+          wrap(out, "@" + std::to_string(run) + "*(" + num + ")", col);
+          ii += run;
+        }
+        else
+          for (int rr = 0; rr < run; rr++, ii++)
+            wrap(out, num, col);
+      }
+    }
+    else
+      out << "##$PN" << nn << "= " << number();
+    out << "\n";
+    if (chance(0.05))
+      out << "$$ @vis= comment " << nn << "\n";
+  }
+
+  void block(std::ostream & out, int index, int blocknum)
+  {
+    out << "##TITLE= synthetic " << index << "." << blocknum << "\n"
+        << "##JCAMPDX= 4.24\n"
+        << "##DATATYPE= Parameter Values\n"
+        << "##ORIGIN= jcampgen\n"
+        << "##OWNER= nobody\n"
+        << "$$ " << index << " seed " << _params.seed << "\n";
+    for (int ii = 0; ii < _params.labels; ii++)
+      label(out, ii);
+    out << "##END=\n";
+  }
+
+  JcampGenParams _params;
+  uint64_t _state;
+};
+
+#endif // JCAMPGEN_HPP
@@ -0,0 +1,144 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// stress test for parsing jcamp-dx files from many threads at once
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Linux: g++ -std=c++11 -O1 -g -pthread -fsanitize=thread -o jcampstress jcampstress.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+//
+// jcampstress [-t threads] [-r rounds] [-p] file...
+//   parses every file once serially, then from 'threads' threads at once
+//   ('rounds' times each, every thread in a different order, alternating
+//   loadFile & loadString), and checks that every result prints exactly
+//   like the serial one.  files that fail to parse must fail the same way.
+//   exits non-zero on any difference.
+//   -p loads the threads' sets into one LdrPool, and checks a getLdr()
+//   reference stays good over the next getLdr() & setString() of the
+//   same label, and an ldr from shareLdr() unchanged.  build with
+//   -fsanitize=address to catch a stale one, see testpool.sh
+//
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "jcampdx.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_ALL);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  std::cerr << location << ":" << str << "\n";
+}
+
+// what parsing 'filename' gives: the printed Ldrset, or the error
+static string
+parse(const string & filename, bool fromstring, const std::shared_ptr<LdrPool> & pool)
+{
+  try {
+    Ldrset ldrs;
+    if (pool)
+      ldrs.setPool(pool);
+    if (fromstring) {
+      std::ifstream in(filename.c_str(), std::ios::binary);
+      stringstream contents;
+      contents << in.rdbuf();
+      ldrs.loadString(contents.str(), filename);
+    }
+    else
+      ldrs.loadFile(filename);
+    stringstream out;
+    out << ldrs;
+    if (pool) {
+      // the set's own ldr, not whatever the pool holds, from the first
+      // getLdr() on.  changing it leaves the other sets' ldrs be, and
+      // what shareLdr() handed out before
+      for (auto & label : ldrs.getLabels()) {
+        std::shared_ptr<const Ldr> held = ldrs.shareLdr(label);
+        stringstream heldbefore, heldafter;
+        heldbefore << *held;
+        Ldr & first = ldrs.getLdr(label);
+        Ldr & again = ldrs.getLdr(label);
+        size_t size = first.size();
+        stringstream before, after;
+        before << first;
+        if (&again != &first)
+          return "error: getLdr(" + label + ") moved";
+        ldrs.setString(label, "##stress", size, true);
+        after << first;
+        if (first.size() != size + 1 || after.str() == before.str())
+          return "error: setString(" + label + ") missed getLdr()'s ldr";
+        heldafter << *held;
+        if (heldafter.str() != heldbefore.str())
+          return "error: setString(" + label + ") changed shareLdr()'s ldr";
+      }
+    }
+    return out.str();
+  }
+  catch (const std::exception & ex) {
+    return string("error: ") + ex.what();
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned nthreads = std::thread::hardware_concurrency();
+  int rounds = 4;
+  std::shared_ptr<LdrPool> pool;
+  std::vector<string> files;
+  for (int ii = 1; ii < argc; ii++) {
+    if (!strcmp(argv[ii], "-t") && ii + 1 < argc)
+      nthreads = (unsigned)atoi(argv[++ii]);
+    else if (!strcmp(argv[ii], "-r") && ii + 1 < argc)
+      rounds = atoi(argv[++ii]);
+    else if (!strcmp(argv[ii], "-p"))
+      pool = std::make_shared<LdrPool>();
+    else
+      files.push_back(argv[ii]);
+  }
+  if (files.empty() || !nthreads) {
+    std::cerr << "usage: " << argv[0] << " [-t threads] [-r rounds] [-p] file...\n";
+    return 1;
+  }
+
+  std::vector<string> expected;
+  size_t nerrors = 0;
+  for (auto & filename : files) {
+    expected.push_back(parse(filename, false, NULL));
+    nerrors += expected.back().compare(0, 7, "error: ") == 0;
+  }
+
+  std::atomic<size_t> parses(0), mismatches(0);
+  std::vector<std::thread> threads;
+  for (unsigned tt = 0; tt < nthreads; tt++)
+    threads.emplace_back([&, tt] {
+        for (int rr = 0; rr < rounds; rr++)
+          for (size_t ii = 0; ii < files.size(); ii++) {
+            size_t ff = (ii * (tt + 1) + rr + tt) % files.size();
+            string got = parse(files[ff], (tt + rr + ii) % 2, pool);
+            parses++;
+            // loadString names the source differently in errors, only
+            // insist that it fails too
+            bool same = got == expected[ff]
+              || (got.compare(0, 7, "error: ") == 0 && expected[ff].compare(0, 7, "error: ") == 0);
+            if (!same) {
+              mismatches++;
+              std::cerr << "thread " << tt << ": " << files[ff] << " differs from serial parse\n";
+            }
+          }
+      });
+  // flip the debug level under them
+  for (int ii = 0; ii < 100; ii++) {
+    g_debug_level = ii % 2 ? LEVEL_ALL : LEVEL_ERROR;
+    std::this_thread::yield();
+  }
+  for (auto & th : threads)
+    th.join();
+
+  std::cout << files.size() << " files (" << nerrors << " with errors), "
+            << nthreads << " threads, " << parses << " parses, "
+            << mismatches << " mismatches\n";
+  return mismatches ? 2 : 0;
+}
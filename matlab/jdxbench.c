@@ -0,0 +1,148 @@
+/* -*-  Mode: C; c-basic-offset: 2 -*-
+ *
+ * benchmark of the C interface to the JCAMP-DX reader
+ *
+ * (c)2016 Michael Tesch, tesch1@gmail.com
+ *
+ * Linux: gcc -O2 -c jdxbench.c && g++ -std=c++11 -O2 -o jdxbench jdxbench.o jcampdx_c.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+ *
+ * jdxbench file [repeats]
+ *   times parsing 'file' from disk and from memory, walking its labels,
+ *   and getting all of its numbers out: per element, by bulk copy, and
+ *   through the zero-copy pointer.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "jcampdx_c.h"
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+report(const char * what, double secs, int repeats, double items)
+{
+  printf("%-22s %10.3f us/iter", what, secs / repeats * 1e6);
+  if (items > 0)
+    printf("  %8.2f ns/item", secs / (repeats * items) * 1e9);
+  printf("\n");
+}
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s file.jdx [repeats]\n", argv[0]);
+    return 1;
+  }
+  const char * filename = argv[1];
+  int repeats = argc > 2 ? atoi(argv[2]) : 100;
+  if (repeats < 1)
+    repeats = 1;
+
+  /* the file in memory, for jdx_ldrset_load_buffer */
+  FILE * fp = fopen(filename, "rb");
+  if (!fp) {
+    perror(filename);
+    return 1;
+  }
+  fseek(fp, 0, SEEK_END);
+  long len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  char * buf = malloc(len > 0 ? len : 1);
+  if (!buf || fread(buf, 1, len, fp) != (size_t)len) {
+    perror(filename);
+    return 1;
+  }
+  fclose(fp);
+
+  double t0 = now();
+  for (int rr = 0; rr < repeats; rr++) {
+    jdx_ldrset * ldrs = jdx_ldrset_new();
+    if (jdx_ldrset_load_file(ldrs, filename)) {
+      fprintf(stderr, "%s: %s\n", filename, jdx_last_error());
+      return 1;
+    }
+    jdx_ldrset_free(ldrs);
+  }
+  report("load_file", now() - t0, repeats, 0);
+
+  t0 = now();
+  for (int rr = 0; rr < repeats; rr++) {
+    jdx_ldrset * ldrs = jdx_ldrset_new();
+    jdx_ldrset_load_buffer(ldrs, buf, len, filename);
+    jdx_ldrset_free(ldrs);
+  }
+  report("load_buffer", now() - t0, repeats, 0);
+
+  jdx_ldrset * ldrs = jdx_ldrset_new();
+  jdx_ldrset_load_buffer(ldrs, buf, len, filename);
+  size_t nlabels = jdx_ldrset_count(ldrs);
+
+  /* walk the labels, size & type of each */
+  size_t nrecords = 0, nnumbers = 0;
+  t0 = now();
+  for (int rr = 0; rr < repeats; rr++) {
+    nrecords = nnumbers = 0;
+    for (size_t ii = 0; ii < nlabels; ii++) {
+      const jdx_ldr * ldr = jdx_ldrset_at(ldrs, ii);
+      nrecords += jdx_ldr_size(ldr);
+      if (jdx_ldr_is_numeric(ldr))
+        nnumbers += jdx_ldr_size(ldr);
+    }
+  }
+  report("labels", now() - t0, repeats, nlabels);
+
+  /* all the numbers, three ways */
+  double sum[3] = { 0, 0, 0 };
+  double * tmp = malloc((nnumbers ? nnumbers : 1) * sizeof(double));
+  t0 = now();
+  for (int rr = 0; rr < repeats; rr++)
+    for (size_t ii = 0; ii < nlabels; ii++) {
+      const jdx_ldr * ldr = jdx_ldrset_at(ldrs, ii);
+      if (!jdx_ldr_is_numeric(ldr))
+        continue;
+      size_t nn = jdx_ldr_size(ldr);
+      for (size_t jj = 0; jj < nn; jj++)
+        sum[0] += jdx_ldr_num(ldr, jj);
+    }
+  report("numbers: per element", now() - t0, repeats, nnumbers);
+
+  t0 = now();
+  for (int rr = 0; rr < repeats; rr++)
+    for (size_t ii = 0; ii < nlabels; ii++) {
+      const jdx_ldr * ldr = jdx_ldrset_at(ldrs, ii);
+      if (!jdx_ldr_is_numeric(ldr))
+        continue;
+      size_t nn = jdx_ldr_get_doubles(ldr, tmp, nnumbers);
+      for (size_t jj = 0; jj < nn; jj++)
+        sum[1] += tmp[jj];
+    }
+  report("numbers: bulk copy", now() - t0, repeats, nnumbers);
+
+  t0 = now();
+  for (int rr = 0; rr < repeats; rr++)
+    for (size_t ii = 0; ii < nlabels; ii++) {
+      const jdx_ldr * ldr = jdx_ldrset_at(ldrs, ii);
+      const double * data = jdx_ldr_data(ldr);
+      if (!data || !jdx_ldr_is_numeric(ldr))
+        continue;
+      size_t nn = jdx_ldr_size(ldr);
+      for (size_t jj = 0; jj < nn; jj++)
+        sum[2] += data[jj];
+    }
+  report("numbers: zero copy", now() - t0, repeats, nnumbers);
+
+  printf("%zu labels, %zu records, %zu numbers, sums %g %g %g\n",
+         nlabels, nrecords, nnumbers, sum[0], sum[1], sum[2]);
+  free(tmp);
+  free(buf);
+  jdx_ldrset_free(ldrs);
+  return 0;
+}
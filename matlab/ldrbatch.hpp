@@ -0,0 +1,54 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// load many jcamp-dx files at once on a thread pool
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#ifndef LDRBATCH_HPP
+#define LDRBATCH_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "jcampdx.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+struct LdrLoadResult
+{
+  std::unique_ptr<Ldrset> ldrset;  //!< NULL if the load failed
+  string error;                    //!< why it failed
+};
+
+//! parse every file in 'filenames' on 'nthreads' threads (0 = all)
+//
+// a file that can't be read or parsed gets an error message instead of an
+// Ldrset, the others are still loaded.  results are in the same order as
+// 'filenames'.  'policy' says how the numbers are stored.  with a 'pool',
+// ldrs equal across the files (ie. a study's scans) are kept just once,
+// with a 'dict' so are their short strings, as codes.
+inline std::vector<LdrLoadResult>
+ldr_load_many(const std::vector<string> & filenames, unsigned nthreads = 0,
+              const NumPolicy & policy = NumPolicy(),
+              const std::shared_ptr<LdrPool> & pool = std::shared_ptr<LdrPool>(),
+              const std::shared_ptr<LdrDict> & dict = std::shared_ptr<LdrDict>())
+{
+  TRACE_SPAN("ldr_load_many");
+  std::vector<LdrLoadResult> results(filenames.size());
+  parallel_for(filenames.size(), [&](size_t ii) {
+      try {
+        std::unique_ptr<Ldrset> ldrs(new Ldrset());
+        ldrs->setNumPolicy(policy);
+        ldrs->setPool(pool);
+        ldrs->setDict(dict);
+        ldrs->loadFile(filenames[ii]);
+        results[ii].ldrset = std::move(ldrs);
+      }
+      catch (const std::exception & ex) {
+        results[ii].error = ex.what();
+      }
+    }, nthreads);
+  return results;
+}
+
+#endif // LDRBATCH_HPP
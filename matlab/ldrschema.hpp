@@ -0,0 +1,303 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// typed schemas for well-known Bruker parameter files
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// A schema is a plain struct whose members are named after the labels they
+// are read from, less the '$' (labels are matched the way Label normalizes
+// them, so SW_h reads ##$SW_h= and PVM_Fov reads ##$PVM_Fov=):
+//
+//   struct MyPars { int TD = 0; double SW_h = 0; string PULPROG; };
+//   LDR_SCHEMA_BEGIN(MyPars, "acqus")
+//     LDR_FIELD(TD), LDR_FIELD(SW_h), LDR_FIELD(PULPROG),
+//   LDR_SCHEMA_END()
+//
+//   MyPars pars;
+//   LdrFound<MyPars> found = ldr_schema_load(acqus, pars);
+//   if (!found.has("SW_h")) ...
+//
+// The member types pick the conversion at compile time, and each label is
+// normalized once per process rather than once per lookup.  Members whose
+// label isn't in the set keep the value they had.  A number that isn't one
+// (ie. a string where an int is expected) throws std::invalid_argument.
+//
+// Supported member types: int, double, float, bool ("Yes"/"On"/"True" or
+// non-zero), string and std::vector<> of each of those but bool.
+//
+// AcqusCore, ProcsCore, AcqpCore, MethodCore and VisuCore are the
+// commonly used parts of acqus, procs, acqp, method and visu_pars.
+//
+#ifndef LDRSCHEMA_HPP
+#define LDRSCHEMA_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "jcampdx.hpp"
+
+template <typename S>
+struct LdrField
+{
+  constexpr LdrField(const char * name, void (*fn)(S &, const Ldr &))
+    : label(name), set(fn) {}
+  const char * label;               //!< as declared, ie. "SW_h"
+  void (*set)(S &, const Ldr &);    //!< converts the ldr into the member
+};
+
+//! specialized by LDR_SCHEMA_BEGIN for each schema
+template <typename S> struct LdrSchema;
+
+//
+// conversions, one per member type
+//
+inline double
+ldr_field_num(const Ldr & ldr, size_t idx, bool integer)
+{
+  double val = ldr.num(idx);
+  if (integer && std::isnan(val))
+    throw std::invalid_argument("ldr_schema_load: " + ldr.label() + " is not a number: '" +
+                                ldr.str(idx) + "'");
+  return val;
+}
+
+inline void ldr_field_get(const Ldr & ldr, size_t idx, double & val) { val = ldr_field_num(ldr, idx, false); }
+inline void ldr_field_get(const Ldr & ldr, size_t idx, float & val) { val = (float)ldr_field_num(ldr, idx, false); }
+inline void ldr_field_get(const Ldr & ldr, size_t idx, int & val) { val = (int)ldr_field_num(ldr, idx, true); }
+inline void ldr_field_get(const Ldr & ldr, size_t idx, string & val) { val = ldr.str(idx); }
+
+inline void
+ldr_field_get(const Ldr & ldr, size_t idx, bool & val)
+{
+  if (ldr.type(idx) == RECORD_NUMERIC) {
+    val = ldr.num(idx) != 0;
+    return;
+  }
+  const string & str = ldr.str(idx);
+  val = str == "Yes" || str == "On" || str == "True" || str == "yes" || str == "on" || str == "true";
+}
+
+template <typename T>
+inline void
+ldr_field_get(const Ldr & ldr, T & val)
+{
+  if (ldr.size())
+    ldr_field_get(ldr, 0, val);
+}
+
+template <typename T>
+inline void
+ldr_field_get(const Ldr & ldr, std::vector<T> & val)
+{
+  val.resize(ldr.size());
+  for (size_t ii = 0; ii < val.size(); ii++) {
+    T elem;
+    ldr_field_get(ldr, ii, elem);
+    val[ii] = elem;
+  }
+}
+
+inline void
+ldr_field_get(const Ldr & ldr, std::vector<double> & val)
+{
+  val.resize(ldr.size());
+  if (!val.empty())
+    ldr.copyNums(&val[0], val.size());
+}
+
+template <typename S, typename T, T S::*member>
+void
+ldr_field_set(S & out, const Ldr & ldr)
+{
+  ldr_field_get(ldr, out.*member);
+}
+
+//! which fields of an S ldr_schema_load() found, in declaration order
+template <typename S>
+class LdrFound
+{
+public:
+  LdrFound() : _mask(0) {}
+  void set(size_t field) { _mask |= (uint64_t)1 << field; }
+  bool has(size_t field) const { return (_mask >> field) & 1; }
+  //! by member name, which must be one of the schema's
+  bool has(const char * label) const
+  {
+    size_t count;
+    const LdrField<S> * fields = LdrSchema<S>::fields(count);
+    for (size_t ii = 0; ii < count; ii++)
+      if (!strcmp(fields[ii].label, label))
+        return has(ii);
+    throw std::invalid_argument(string("LdrFound: ") + LdrSchema<S>::name() + " has no field " + label);
+  }
+  size_t count() const
+  {
+    size_t nn = 0;
+    for (uint64_t mm = _mask; mm; mm &= mm - 1)
+      nn++;
+    return nn;
+  }
+private:
+  uint64_t _mask;
+};
+
+//! fill 'out' from 'ldrs', one lookup per field and no normalizing
+template <typename S>
+LdrFound<S>
+ldr_schema_load(const Ldrset & ldrs, S & out)
+{
+  size_t count;
+  const LdrField<S> * fields = LdrSchema<S>::fields(count);
+  // normalized once, the first time this schema is loaded
+  static const std::vector<Label> labels = [&] {
+    std::vector<Label> ll;
+    for (size_t ii = 0; ii < count; ii++)
+      ll.push_back(Label(fields[ii].label));
+    return ll;
+  }();
+  LdrFound<S> found;
+  for (size_t ii = 0; ii < count; ii++) {
+    const Ldr * ldr = ldrs.findLdr(labels[ii]);
+    if (!ldr)
+      continue;
+    fields[ii].set(out, *ldr);
+    found.set(ii);
+  }
+  return found;
+}
+
+//! declares S's fields, LDR_FIELD(member), ..., up to 64
+#define LDR_SCHEMA_BEGIN(S, filename)                                   \
+  template <> struct LdrSchema<S> {                                     \
+    typedef S type;                                                     \
+    static const char * name() { return filename; }                     \
+    static const LdrField<S> * fields(size_t & count) {                 \
+      static constexpr LdrField<S> table[] = {
+
+#define LDR_FIELD(member)                                               \
+  LdrField<type>(#member, &ldr_field_set<type, decltype(type::member), &type::member>)
+
+#define LDR_SCHEMA_END()                                                \
+      };                                                                \
+      static_assert(sizeof(table) / sizeof(table[0]) <= 64, "LdrFound has 64 bits"); \
+      count = sizeof(table) / sizeof(table[0]);                         \
+      return table;                                                     \
+    }                                                                   \
+  };
+
+//
+// ready-made schemas
+//
+
+//! TopSpin acquisition parameters
+struct AcqusCore
+{
+  int TD = 0, NS = 0, DS = 0;
+  int DECIM = 0, DSPFVS = 0, DIGMOD = 0;
+  int BYTORDA = 0, DTYPA = 0;
+  int AQ_mod = 0, FnMODE = 0;
+  double SW_h = 0, SW = 0, BF1 = 0, SFO1 = 0, O1 = 0;
+  double RG = 0, DE = 0, GRPDLY = 0;
+  string PULPROG, NUC1, SOLVENT, INSTRUM;
+};
+
+LDR_SCHEMA_BEGIN(AcqusCore, "acqus")
+  LDR_FIELD(TD), LDR_FIELD(NS), LDR_FIELD(DS),
+  LDR_FIELD(DECIM), LDR_FIELD(DSPFVS), LDR_FIELD(DIGMOD),
+  LDR_FIELD(BYTORDA), LDR_FIELD(DTYPA),
+  LDR_FIELD(AQ_mod), LDR_FIELD(FnMODE),
+  LDR_FIELD(SW_h), LDR_FIELD(SW), LDR_FIELD(BF1), LDR_FIELD(SFO1), LDR_FIELD(O1),
+  LDR_FIELD(RG), LDR_FIELD(DE), LDR_FIELD(GRPDLY),
+  LDR_FIELD(PULPROG), LDR_FIELD(NUC1), LDR_FIELD(SOLVENT), LDR_FIELD(INSTRUM),
+LDR_SCHEMA_END()
+
+//! TopSpin processing parameters, of one dimension
+struct ProcsCore
+{
+  int SI = 0, XDIM = 0, TDeff = 0;
+  int BYTORDP = 0, DTYPP = 0, NC_proc = 0;
+  int WDW = 0, PH_mod = 0;
+  double SF = 0, SW_p = 0, OFFSET = 0;
+  double LB = 0, GB = 0, SSB = 0, PHC0 = 0, PHC1 = 0;
+};
+
+LDR_SCHEMA_BEGIN(ProcsCore, "procs")
+  LDR_FIELD(SI), LDR_FIELD(XDIM), LDR_FIELD(TDeff),
+  LDR_FIELD(BYTORDP), LDR_FIELD(DTYPP), LDR_FIELD(NC_proc),
+  LDR_FIELD(WDW), LDR_FIELD(PH_mod),
+  LDR_FIELD(SF), LDR_FIELD(SW_p), LDR_FIELD(OFFSET),
+  LDR_FIELD(LB), LDR_FIELD(GB), LDR_FIELD(SSB), LDR_FIELD(PHC0), LDR_FIELD(PHC1),
+LDR_SCHEMA_END()
+
+//! ParaVision acquisition parameters
+struct AcqpCore
+{
+  int ACQ_dim = 0, NI = 0, NR = 0, NA = 0, NAE = 0, DS = 0;
+  std::vector<int> ACQ_size, ACQ_obj_order;
+  double BF1 = 0, SFO1 = 0, SW_h = 0;
+  std::vector<double> ACQ_repetition_time, ACQ_echo_time;
+  string ACQ_method, ACQ_protocol_name, PULPROG;
+  string GO_raw_data_format, BYTORDA;
+  std::vector<string> ACQ_dim_desc;
+};
+
+LDR_SCHEMA_BEGIN(AcqpCore, "acqp")
+  LDR_FIELD(ACQ_dim), LDR_FIELD(NI), LDR_FIELD(NR), LDR_FIELD(NA), LDR_FIELD(NAE), LDR_FIELD(DS),
+  LDR_FIELD(ACQ_size), LDR_FIELD(ACQ_obj_order),
+  LDR_FIELD(BF1), LDR_FIELD(SFO1), LDR_FIELD(SW_h),
+  LDR_FIELD(ACQ_repetition_time), LDR_FIELD(ACQ_echo_time),
+  LDR_FIELD(ACQ_method), LDR_FIELD(ACQ_protocol_name), LDR_FIELD(PULPROG),
+  LDR_FIELD(GO_raw_data_format), LDR_FIELD(BYTORDA),
+  LDR_FIELD(ACQ_dim_desc),
+LDR_SCHEMA_END()
+
+//! ParaVision method parameters
+struct MethodCore
+{
+  string Method;
+  std::vector<int> PVM_Matrix, PVM_EncMatrix, PVM_SPackArrNSlices;
+  std::vector<double> PVM_Fov, PVM_SpatResol;
+  int PVM_NAverages = 0, PVM_NRepetitions = 0, PVM_DwNDiffExp = 0;
+  double PVM_RepetitionTime = 0, PVM_EchoTime = 0, PVM_SliceThick = 0;
+  std::vector<double> PVM_DwEffBval;
+  string PVM_ScanTimeStr;
+};
+
+LDR_SCHEMA_BEGIN(MethodCore, "method")
+  LDR_FIELD(Method),
+  LDR_FIELD(PVM_Matrix), LDR_FIELD(PVM_EncMatrix), LDR_FIELD(PVM_SPackArrNSlices),
+  LDR_FIELD(PVM_Fov), LDR_FIELD(PVM_SpatResol),
+  LDR_FIELD(PVM_NAverages), LDR_FIELD(PVM_NRepetitions), LDR_FIELD(PVM_DwNDiffExp),
+  LDR_FIELD(PVM_RepetitionTime), LDR_FIELD(PVM_EchoTime), LDR_FIELD(PVM_SliceThick),
+  LDR_FIELD(PVM_DwEffBval),
+  LDR_FIELD(PVM_ScanTimeStr),
+LDR_SCHEMA_END()
+
+//! ParaVision reconstructed image parameters.  a frame count of 1 is
+//! what's meant when there isn't one
+struct VisuCore
+{
+  int VisuCoreDim = 0, VisuCoreFrameCount = 1;
+  std::vector<int> VisuCoreSize;
+  string VisuCoreWordType, VisuCoreByteOrder, VisuCoreFrameType;
+  std::vector<double> VisuCoreExtent, VisuCoreDataSlope, VisuCoreDataOffs;
+  std::vector<double> VisuCoreDataMin, VisuCoreDataMax;
+  std::vector<string> VisuCoreUnits, VisuCoreDimDesc;
+  std::vector<double> VisuAcqEchoTime;
+  double VisuAcqRepetitionTime = 0;
+};
+
+LDR_SCHEMA_BEGIN(VisuCore, "visu_pars")
+  LDR_FIELD(VisuCoreDim), LDR_FIELD(VisuCoreFrameCount),
+  LDR_FIELD(VisuCoreSize),
+  LDR_FIELD(VisuCoreWordType), LDR_FIELD(VisuCoreByteOrder), LDR_FIELD(VisuCoreFrameType),
+  LDR_FIELD(VisuCoreExtent), LDR_FIELD(VisuCoreDataSlope), LDR_FIELD(VisuCoreDataOffs),
+  LDR_FIELD(VisuCoreDataMin), LDR_FIELD(VisuCoreDataMax),
+  LDR_FIELD(VisuCoreUnits), LDR_FIELD(VisuCoreDimDesc),
+  LDR_FIELD(VisuAcqEchoTime), LDR_FIELD(VisuAcqRepetitionTime),
+LDR_SCHEMA_END()
+
+#endif // LDRSCHEMA_HPP
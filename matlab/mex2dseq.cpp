@@ -0,0 +1,60 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// ParaVision 2dseq image mex wrapper
+//
+// Macos: mex mex2dseq.cpp visudata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+// Linux: mex mex2dseq.cpp visudata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC"
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <cstring>
+#include "mex.h"
+#include "visudata.hpp"
+#include "debug.hpp"
+#include "trace.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_WARN);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  mexWarnMsgTxt((string(location) + ":" + str).c_str());
+}
+
+/* img = mex2dseq(procpath [, 'single']) */
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  char procpath[512];
+  char cls[16] = "double";
+  const char * errmsg = "usage: img = mex2dseq('../path/to/pdata/1' [, 'single'|'double'])\n";
+
+  if (nrhs < 1 || nrhs > 2 || nlhs != 1 || !mxIsChar(prhs[0])) {
+    mexWarnMsgTxt(" bad params");
+    mexErrMsgTxt(errmsg);
+  }
+  if (mxGetString(prhs[0], procpath, sizeof(procpath)) ||
+      (nrhs == 2 && mxGetString(prhs[1], cls, sizeof(cls)))) {
+    mexWarnMsgTxt(" can't get arguments");
+    mexErrMsgTxt(errmsg);
+  }
+  bool single = !strcmp(cls, "single");
+  if (!single && strcmp(cls, "double"))
+    mexErrMsgTxt(errmsg);
+
+  try {
+    TraceFlush flush;
+    TRACE_SPAN("mex2dseq", procpath);
+    VisuData visu(procpath);
+    std::vector<size_t> shape = visu.shape();
+    std::vector<mwSize> dims(shape.begin(), shape.end());
+    if (dims.size() < 2)
+      dims.resize(2, 1);
+    plhs[0] = mxCreateNumericArray(dims.size(), &dims[0],
+                                   single ? mxSINGLE_CLASS : mxDOUBLE_CLASS, mxREAL);
+    if (single)
+      visu.read((float *)mxGetData(plhs[0]));
+    else
+      visu.read(mxGetPr(plhs[0]));
+  }
+  catch (std::exception & exc) {
+    mexErrMsgIdAndTxt("mex2dseq:read", "%s: %s", procpath, exc.what());
+  }
+}
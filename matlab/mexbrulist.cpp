@@ -0,0 +1,54 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// bruker list file (vdlist, vclist, fq1list...) mex wrapper
+//
+// Macos: mex mexbrulist.cpp brulist.cpp
+// Linux: mex mexbrulist.cpp brulist.cpp CXXFLAGS="-std=c++11 -fPIC"
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <cstring>
+#include "mex.h"
+#include "brulist.hpp"
+
+/* [values, reference] = mexbrulist(filename [, unitscale [, 'fq']]) */
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  char listfile[512];
+  double unitscale = 1.0;
+  bool fqlist = false;
+  const char * errmsg =
+    "usage: [values, reference] = mexbrulist('../path/to/vdlist' [, unitscale [, 'fq']])\n";
+
+  if (nrhs < 1 || nrhs > 3 || nlhs > 2 || !mxIsChar(prhs[0])) {
+    mexWarnMsgTxt(" bad params");
+    mexErrMsgTxt(errmsg);
+  }
+  if (mxGetString(prhs[0], listfile, sizeof(listfile))) {
+    mexWarnMsgTxt(" can't get list file name from argument");
+    mexErrMsgTxt(errmsg);
+  }
+  if (nrhs >= 2) {
+    if (!mxIsDouble(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 1)
+      mexErrMsgTxt(errmsg);
+    unitscale = mxGetScalar(prhs[1]);
+  }
+  if (nrhs == 3) {
+    char kind[8];
+    if (!mxIsChar(prhs[2]) || mxGetString(prhs[2], kind, sizeof(kind)) || strcmp(kind, "fq"))
+      mexErrMsgTxt(errmsg);
+    fqlist = true;
+  }
+
+  try {
+    BruList list(listfile, unitscale, fqlist);
+    plhs[0] = mxCreateDoubleMatrix(list.size(), 1, mxREAL);
+    if (list.size())
+      memcpy(mxGetPr(plhs[0]), &list.values()[0], list.size() * sizeof(double));
+    if (nlhs > 1)
+      plhs[1] = mxCreateString(list.reference().c_str());
+  }
+  catch (std::exception & exc) {
+    mexErrMsgIdAndTxt("mexbrulist:read", "%s", exc.what());
+  }
+}
@@ -0,0 +1,76 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// fid/ser to spectrum processing mex wrapper
+//
+// Macos: mex mexfidproc.cpp fidproc.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+// Linux: mex mexfidproc.cpp fidproc.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC -pthread"
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <sstream>
+#include "mex.h"
+#include "rawdata.hpp"
+#include "fidproc.hpp"
+#include "debug.hpp"
+#include "trace.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_WARN);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  mexWarnMsgTxt((string(location) + ":" + str).c_str());
+}
+
+/* spec = mexfidproc(exppath [, procno]) */
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  char exppath[512];
+  int procno = 1;
+  const char * errmsg =
+    "usage: spec = mexfidproc('../path/to/expno' [, procno])\n"
+    "  window, zero fill, ft and phase every fid using pdata/procno/procs\n"
+    "  spec: SI x rows, complex, in the same order as 1r/1i (unscaled)\n";
+
+  if (nrhs < 1 || nrhs > 2 || nlhs > 1 || !mxIsChar(prhs[0])) {
+    mexWarnMsgTxt(" bad params");
+    mexErrMsgTxt(errmsg);
+  }
+  if (mxGetString(prhs[0], exppath, sizeof(exppath))) {
+    mexWarnMsgTxt(" can't get arguments");
+    mexErrMsgTxt(errmsg);
+  }
+  if (nrhs == 2) {
+    if (!mxIsNumeric(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 1)
+      mexErrMsgTxt(errmsg);
+    procno = (int)mxGetScalar(prhs[1]);
+  }
+
+  try {
+    TraceFlush flush;
+    TRACE_SPAN("mexfidproc", exppath);
+    RawData raw(exppath, GRPDLY_SHIFT);
+    std::stringstream procpath;
+    procpath << exppath << "/pdata/" << procno << "/procs";
+    Ldrset procs;
+    procs.loadFile(procpath.str());
+    ProcParams params(procs, raw.acqus());
+    params.grpdly = raw.residualDelay();
+    FidProcessor proc(params);
+
+    size_t rows = raw.rows();
+    std::vector<cplx> fids(rows * raw.points());
+    std::vector<cplx> spec(rows * proc.size());
+    raw.readRows(0, rows, fids.data());
+    proc.process(fids.data(), raw.points(), rows, spec.data());
+
+    plhs[0] = mxCreateDoubleMatrix(proc.size(), rows, mxCOMPLEX);
+    double * re = mxGetPr(plhs[0]);
+    double * im = mxGetPi(plhs[0]);
+    for (size_t ii = 0; ii < spec.size(); ii++) {
+      re[ii] = spec[ii].real();
+      im[ii] = spec[ii].imag();
+    }
+  }
+  catch (std::exception & exc) {
+    mexErrMsgIdAndTxt("mexfidproc:process", "%s: %s", exppath, exc.what());
+  }
+}
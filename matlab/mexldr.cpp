@@ -11,11 +11,12 @@
 #include "mex.h"
 #include "jcampdx.hpp"
 #include "debug.hpp"
+#include "trace.hpp"
 
-DebugLevel g_debug_level = LEVEL_INFO2;
-void DebugFunc(DebugLevel level, string str, string location)
+std::atomic<DebugLevel> g_debug_level(LEVEL_INFO2);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
 {
-  mexErrMsgTxt((location + ":" + str).c_str());
+  mexErrMsgTxt((string(location) + ":" + str).c_str());
 }
 
 /* paramstruct = mexLoadLDRS(filename) */
@@ -39,6 +40,10 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     mexErrMsgTxt(errmsg);
   }
 
+  /* with $BRUKITCHEN_TRACE set, append this call's spans to the trace */
+  TraceFlush flush;
+  TRACE_SPAN("mexldr", ldrfile);
+
   /* read the procpar */
   try {
     ldrset.loadFile(ldrfile);
@@ -47,6 +52,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     mexWarnMsgIdAndTxt("mexldr:loadFile", "%s / %s", ldrfile, exc.what());
   }
   count = ldrset.size();
+  TRACE_SPAN("mexldr::marshal");
 
   /* gather param names into key array */
   keys = (const char **)malloc(sizeof(char *) * count);
@@ -70,7 +76,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     mxArray *field_value = NULL; // compiler warning
     int j, fieldcount;
 
-    Ldr & ldr = ldrset.getLdr(keys[ii]);
+    const Ldr & ldr = ((const Ldrset &)ldrset).getLdr(keys[ii]);
     std::vector<int> shape = ldr.shape();
     fieldcount = dims[0] = shape[0];
     if (shape.size() > 1) {
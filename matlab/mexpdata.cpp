@@ -0,0 +1,73 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// TopSpin processed data mex wrapper
+//
+// Macos: mex mexpdata.cpp procdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+// Linux: mex mexpdata.cpp procdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC"
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include "mex.h"
+#include "procdata.hpp"
+#include "debug.hpp"
+#include "trace.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_WARN);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  mexWarnMsgTxt((string(location) + ":" + str).c_str());
+}
+
+/* spec = mexpdata(procpath, name [, lo, hi]) */
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  char procpath[512];
+  char name[32];
+  const char * errmsg =
+    "usage: spec = mexpdata('../path/to/pdata/1', '2rr' [, lo, hi])\n"
+    "  lo, hi: optional 1-based inclusive region, one entry per dimension\n";
+
+  if ((nrhs != 2 && nrhs != 4) || nlhs != 1 || !mxIsChar(prhs[0]) || !mxIsChar(prhs[1])) {
+    mexWarnMsgTxt(" bad params");
+    mexErrMsgTxt(errmsg);
+  }
+  if (mxGetString(prhs[0], procpath, sizeof(procpath)) ||
+      mxGetString(prhs[1], name, sizeof(name))) {
+    mexWarnMsgTxt(" can't get path or file name from arguments");
+    mexErrMsgTxt(errmsg);
+  }
+
+  try {
+    TraceFlush flush;
+    TRACE_SPAN("mexpdata", procpath);
+    ProcData pdata(procpath);
+    size_t nd = ProcData::fileDims(name);
+    std::vector<size_t> lo(nd), hi(nd);
+    for (size_t dd = 0; dd < nd; dd++)
+      hi[dd] = pdata.size(dd);
+
+    if (nrhs == 4) {
+      if (!mxIsDouble(prhs[2]) || !mxIsDouble(prhs[3]) ||
+          mxGetNumberOfElements(prhs[2]) != nd || mxGetNumberOfElements(prhs[3]) != nd)
+        mexErrMsgTxt(errmsg);
+      for (size_t dd = 0; dd < nd; dd++) {
+        double l = mxGetPr(prhs[2])[dd];
+        double h = mxGetPr(prhs[3])[dd];
+        if (l < 1 || h < l)
+          mexErrMsgTxt("mexpdata: bad region");
+        lo[dd] = (size_t)l - 1;
+        hi[dd] = (size_t)h;
+      }
+    }
+
+    // first (direct) dimension is fastest, which is matlab's column-major order
+    std::vector<mwSize> dims(nd < 2 ? 2 : nd, 1);
+    for (size_t dd = 0; dd < nd; dd++)
+      dims[dd] = hi[dd] - lo[dd];
+    plhs[0] = mxCreateNumericArray(dims.size(), &dims[0], mxDOUBLE_CLASS, mxREAL);
+    pdata.readRegion(name, lo, hi, mxGetPr(plhs[0]));
+  }
+  catch (std::exception & exc) {
+    mexErrMsgIdAndTxt("mexpdata:read", "%s / %s: %s", procpath, name, exc.what());
+  }
+}
@@ -0,0 +1,63 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// raw fid/ser data mex wrapper
+//
+// Macos: mex mexrawdata.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp
+// Linux: mex mexrawdata.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp CXXFLAGS="-std=c++11 -fPIC -pthread"
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <cstring>
+#include "mex.h"
+#include "rawdata.hpp"
+#include "debug.hpp"
+#include "trace.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_WARN);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  mexWarnMsgTxt((string(location) + ":" + str).c_str());
+}
+
+/* [fid, residual] = mexrawdata(exppath [, 'none'|'shift'|'truncate']) */
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  char exppath[512];
+  char modestr[16] = "none";
+  grpdly_mode mode = GRPDLY_NONE;
+  const char * errmsg =
+    "usage: [fid, residual] = mexrawdata('../path/to/expno' [, 'none'|'shift'|'truncate'])\n"
+    "  group delay removal: 'shift' rotates it to the end of each fid, 'truncate' drops it\n"
+    "  residual: the fractional group delay (points) that is left after 'shift'\n";
+
+  if (nrhs < 1 || nrhs > 2 || nlhs < 1 || nlhs > 2 || !mxIsChar(prhs[0])) {
+    mexWarnMsgTxt(" bad params");
+    mexErrMsgTxt(errmsg);
+  }
+  if (mxGetString(prhs[0], exppath, sizeof(exppath)) ||
+      (nrhs == 2 && mxGetString(prhs[1], modestr, sizeof(modestr)))) {
+    mexWarnMsgTxt(" can't get arguments");
+    mexErrMsgTxt(errmsg);
+  }
+  if (!strcmp(modestr, "shift"))
+    mode = GRPDLY_SHIFT;
+  else if (!strcmp(modestr, "truncate"))
+    mode = GRPDLY_TRUNCATE;
+  else if (strcmp(modestr, "none"))
+    mexErrMsgTxt(errmsg);
+
+  try {
+    TraceFlush flush;
+    TRACE_SPAN("mexrawdata", exppath);
+    RawData raw(exppath, mode);
+    // sized from the very mapping read, the ser may still be growing
+    MappedFile data(raw.dataFile());
+    plhs[0] = mxCreateDoubleMatrix(raw.points(), raw.rowsIn(data.size()), mxCOMPLEX);
+    raw.read(data, mxGetPr(plhs[0]), mxGetPi(plhs[0]));
+    if (nlhs > 1)
+      plhs[1] = mxCreateDoubleScalar(raw.residualDelay());
+  }
+  catch (std::exception & exc) {
+    mexErrMsgIdAndTxt("mexrawdata:read", "%s: %s", exppath, exc.what());
+  }
+}
@@ -0,0 +1,169 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// minimal thread pool for data-parallel loops
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+  //! 'nthreads' workers, 0 means one per hardware thread
+  explicit ThreadPool(unsigned nthreads = 0)
+    : _stop(false)
+  {
+    if (!nthreads)
+      nthreads = defaultThreads();
+    for (unsigned ii = 0; ii < nthreads; ii++)
+      _workers.emplace_back(&ThreadPool::work, this);
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    for (auto & th : _workers)
+      th.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  unsigned size() const { return (unsigned)_workers.size(); }
+
+  //! queue a task to be run by one of the workers
+  void submit(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _tasks.push_back(std::move(task));
+    }
+    _wake.notify_one();
+  }
+
+  //! run f(ii) for ii in [0,n) on at most 'maxthreads' threads, return when all are done
+  //
+  // the calling thread takes part in the loop, so this is safe to call from
+  // inside a task.  the first exception thrown by 'f' is rethrown here.
+  void parallelFor(size_t n, const std::function<void(size_t)> & f, unsigned maxthreads = 0)
+  {
+    if (!n)
+      return;
+    unsigned helpers = maxthreads ? maxthreads - 1 : size();
+    if (helpers > size())
+      helpers = size();
+    if (helpers > n - 1)
+      helpers = (unsigned)(n - 1);
+    if (!helpers) {
+      for (size_t ii = 0; ii < n; ii++)
+        f(ii);
+      return;
+    }
+
+    std::shared_ptr<Loop> loop(new Loop(n, f));
+    for (unsigned ii = 0; ii < helpers; ii++)
+      submit([loop]() { loop->run(); });
+    loop->run();
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&]() { return loop->done == loop->n; });
+    if (loop->error)
+      std::rethrow_exception(loop->error);
+  }
+
+  //! process-wide pool, sized by $BRUKITCHEN_THREADS or the hardware
+  static ThreadPool & global()
+  {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  static unsigned defaultThreads()
+  {
+    const char * env = getenv("BRUKITCHEN_THREADS");
+    int nthreads = env ? atoi(env) : 0;
+    if (nthreads <= 0)
+      nthreads = (int)std::thread::hardware_concurrency();
+    return nthreads > 0 ? (unsigned)nthreads : 1;
+  }
+
+private:
+  struct Loop {
+    Loop(size_t count, const std::function<void(size_t)> & func)
+      : n(count), next(0), done(0), f(func) {}
+    void run()
+    {
+      size_t ii, ran = 0;
+      while ((ii = next++) < n) {
+        try {
+          f(ii);
+        }
+        catch (...) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!error)
+            error = std::current_exception();
+        }
+        ran++;
+      }
+      if (ran) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done += ran;
+        if (done == n)
+          finished.notify_all();
+      }
+    }
+    const size_t n;
+    std::atomic<size_t> next;
+    size_t done;
+    std::function<void(size_t)> f;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+  };
+
+  void work()
+  {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+        if (_stop && _tasks.empty())
+          return;
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> _workers;
+  std::deque<std::function<void()> > _tasks;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  bool _stop;
+};
+
+//! run f(ii) for ii in [0,n) on the global pool
+inline void
+parallel_for(size_t n, const std::function<void(size_t)> & f, unsigned maxthreads = 0)
+{
+  ThreadPool::global().parallelFor(n, f, maxthreads);
+}
+
+#endif // PARALLEL_HPP
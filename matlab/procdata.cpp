@@ -0,0 +1,215 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for TopSpin processed data: 1r/1i, 2rr/2ri/2ir/2ii, 3rrr/...
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <cmath>
+#include <memory>
+#include <algorithm>
+
+#include "procdata.hpp"
+#include "ldrschema.hpp"
+#include "trace.hpp"
+
+#define MAXDIM 3
+
+static bool
+fileExists(const string & filename)
+{
+  FILE * fp = fopen(filename.c_str(), "r");
+  if (fp)
+    fclose(fp);
+  return fp != NULL;
+}
+
+ProcData::ProcData()
+  : _dtype(BRU_INT32), _swap(false), _scale(1)
+{
+}
+
+ProcData::ProcData(const string & procpath)
+  : _dtype(BRU_INT32), _swap(false), _scale(1)
+{
+  open(procpath);
+}
+
+void
+ProcData::open(const string & procpath)
+{
+  TRACE_SPAN("ProcData::open", procpath);
+  const char * procfiles[MAXDIM] = { "procs", "proc2s", "proc3s" };
+
+  _procpath = procpath;
+  ProcsCore direct;
+  _procs.clear();
+  _si.clear();
+  _xdim.clear();
+
+  for (int dim = 0; dim < MAXDIM; dim++) {
+    string filename = procpath + "/" + procfiles[dim];
+    if (!fileExists(filename))
+      break;
+    _procs.emplace_back(filename);
+    ProcsCore procs;
+    if (!ldr_schema_load(_procs.back(), procs).has("SI"))
+      throw std::out_of_range("ProcData: " + filename + ": no SI");
+    if (!dim)
+      direct = procs;
+    size_t si = (size_t)procs.SI;
+    size_t xdim = (size_t)procs.XDIM;
+    if (!xdim || xdim > si)
+      xdim = si;
+    if (!si || si % xdim) {
+      stringstream str;
+      str << "ProcData: " << filename << ": SI=" << si << " not a multiple of XDIM=" << xdim;
+      throw std::invalid_argument(str.str());
+    }
+    _si.push_back(si);
+    _xdim.push_back(xdim);
+  }
+
+  if (_procs.empty())
+    throw std::invalid_argument("ProcData: no procs in " + procpath);
+
+  // data format is described by the direct dimension's procs
+  int bytorder = direct.BYTORDP;
+  int dtype = direct.DTYPP;
+  if (dtype != BRU_INT32 && dtype != BRU_FLOAT64) {
+    stringstream str;
+    str << "ProcData: " << procpath << ": unsupported DTYPP=" << dtype;
+    throw std::invalid_argument(str.str());
+  }
+  _dtype = (bru_dtype)dtype;
+  _swap = (bytorder != 0) != bru_host_bigendian();
+  // NC_proc only applies to the integer format
+  _scale = 1;
+  if (_dtype == BRU_INT32)
+    _scale = std::pow(2.0, direct.NC_proc);
+}
+
+size_t
+ProcData::ndim() const
+{
+  return _si.size();
+}
+
+size_t
+ProcData::size(size_t dim) const
+{
+  return _si.at(dim);
+}
+
+size_t
+ProcData::xdim(size_t dim) const
+{
+  return _xdim.at(dim);
+}
+
+size_t
+ProcData::count(size_t ndims) const
+{
+  if (ndims > ndim())
+    throw std::out_of_range("ProcData::count: not enough proc*s files for data dimension");
+  size_t n = 1;
+  for (size_t dd = 0; dd < ndims; dd++)
+    n *= _si[dd];
+  return n;
+}
+
+size_t
+ProcData::fileDims(const string & name)
+{
+  if (name.size() < 2 || name[0] < '1' || name[0] > '0' + MAXDIM)
+    throw std::invalid_argument("ProcData: not a processed data file name: '" + name + "'");
+  return name[0] - '0';
+}
+
+const Ldrset &
+ProcData::procs(size_t dim) const
+{
+  return _procs.at(dim);
+}
+
+void
+ProcData::read(const string & name, double * out) const
+{
+  size_t nd = fileDims(name);
+  std::vector<size_t> lo(nd, 0);
+  std::vector<size_t> hi(_si.begin(), _si.begin() + std::min(nd, _si.size()));
+  readRegion(name, lo, hi, out);
+}
+
+void
+ProcData::readRegion(const string & name,
+                     const std::vector<size_t> & lo,
+                     const std::vector<size_t> & hi,
+                     double * out) const
+{
+  size_t nd = fileDims(name);
+  string filename = _procpath + "/" + name;
+  TRACE_SPAN("ProcData::read", filename);
+
+  if (nd > ndim()) {
+    stringstream str;
+    str << "ProcData: " << filename << " needs " << nd << " proc*s files, have " << ndim();
+    throw std::invalid_argument(str.str());
+  }
+  if (lo.size() != nd || hi.size() != nd)
+    throw std::invalid_argument("ProcData::readRegion: region must have one entry per dimension");
+
+  // pad everything out to MAXDIM with singleton dimensions
+  size_t si[MAXDIM], xd[MAXDIM], ntile[MAXDIM], rlo[MAXDIM], rhi[MAXDIM], rsz[MAXDIM];
+  for (size_t dd = 0; dd < MAXDIM; dd++) {
+    si[dd] = dd < nd ? _si[dd] : 1;
+    xd[dd] = dd < nd ? _xdim[dd] : 1;
+    rlo[dd] = dd < nd ? lo[dd] : 0;
+    rhi[dd] = dd < nd ? hi[dd] : 1;
+    if (rlo[dd] >= rhi[dd] || rhi[dd] > si[dd]) {
+      stringstream str;
+      str << "ProcData::readRegion: bad range [" << rlo[dd] << "," << rhi[dd]
+          << ") for dimension " << dd << " of size " << si[dd];
+      throw std::out_of_range(str.str());
+    }
+    ntile[dd] = si[dd] / xd[dd];
+    rsz[dd] = rhi[dd] - rlo[dd];
+  }
+
+  FILE * fp = fopen(filename.c_str(), "rb");
+  if (!fp) {
+    stringstream str;
+    str << "invalid input file: " << filename << ": " << strerror(errno) << "\n";
+    throw std::invalid_argument(str.str());
+  }
+  std::unique_ptr<FILE, int (*)(FILE *)> closer(fp, fclose);
+
+  const size_t esz = bru_dtype_size(_dtype);
+  const size_t tilepts = xd[0] * xd[1] * xd[2];
+  const size_t tilebytes = tilepts * esz;
+  std::vector<uint8_t> tile(tilebytes);
+  uint64_t filepos = (uint64_t)-1;
+
+  // walk the intersecting tiles in file order, each tile is a cache-sized
+  // block that gets scattered row by row into the output
+  for (size_t t2 = rlo[2] / xd[2]; t2 <= (rhi[2] - 1) / xd[2]; t2++)
+    for (size_t t1 = rlo[1] / xd[1]; t1 <= (rhi[1] - 1) / xd[1]; t1++)
+      for (size_t t0 = rlo[0] / xd[0]; t0 <= (rhi[0] - 1) / xd[0]; t0++) {
+        uint64_t tileno = (t2 * ntile[1] + t1) * ntile[0] + t0;
+        uint64_t offset = tileno * tilebytes;
+        if (offset != filepos)
+          bru_fseek(fp, offset, filename);
+        bru_fread(&tile[0], tilebytes, fp, filename);
+        filepos = offset + tilebytes;
+
+        // intersection of this tile with the region, in global coordinates
+        size_t b0 = std::max(rlo[0], t0 * xd[0]), e0 = std::min(rhi[0], (t0 + 1) * xd[0]);
+        size_t b1 = std::max(rlo[1], t1 * xd[1]), e1 = std::min(rhi[1], (t1 + 1) * xd[1]);
+        size_t b2 = std::max(rlo[2], t2 * xd[2]), e2 = std::min(rhi[2], (t2 + 1) * xd[2]);
+        for (size_t i2 = b2; i2 < e2; i2++)
+          for (size_t i1 = b1; i1 < e1; i1++) {
+            size_t src = ((i2 - t2 * xd[2]) * xd[1] + (i1 - t1 * xd[1])) * xd[0] + (b0 - t0 * xd[0]);
+            size_t dst = ((i2 - rlo[2]) * rsz[1] + (i1 - rlo[1])) * rsz[0] + (b0 - rlo[0]);
+            bru_convert(&tile[src * esz], _dtype, _swap, e0 - b0, out + dst, _scale);
+          }
+      }
+}
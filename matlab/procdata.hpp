@@ -0,0 +1,68 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for TopSpin processed data: 1r/1i, 2rr/2ri/2ir/2ii, 3rrr/...
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// nD processed data is not stored as a plain array but as a sequence of
+// submatrices (tiles) of XDIM points along each dimension.  The tiles
+// are stored in row-major order, with the direct (procs, F2 for 2D)
+// dimension fastest, and each tile is itself row-major.
+//
+#ifndef PROCDATA_HPP
+#define PROCDATA_HPP
+
+#include <string>
+#include <vector>
+#include "jcampdx.hpp"
+#include "bruio.hpp"
+
+class ProcData
+{
+public:
+  ProcData();
+  ProcData(const string & procpath);
+
+  //! read the procs, proc2s and proc3s in the directory 'procpath'
+  void open(const string & procpath);
+
+  //! number of dimensions described by the proc*s files that were found
+  size_t ndim() const;
+  //! SI of dimension 'dim', 0 is the direct dimension (procs)
+  size_t size(size_t dim) const;
+  //! XDIM (tile size) of dimension 'dim'
+  size_t xdim(size_t dim) const;
+  //! total number of points in a 'ndims'-dimensional data file
+  size_t count(size_t ndims) const;
+
+  //! number of dimensions of the data file 'name', ie 2 for "2rr"
+  static size_t fileDims(const string & name);
+
+  //! read the data file 'name' (ie "2rr") into 'out', de-tiled and scaled
+  //
+  // 'out' must hold count(fileDims(name)) values, and point (i0,i1,i2)
+  // ends up at out[i0 + size(0) * (i1 + size(1) * i2)]
+  void read(const string & name, double * out) const;
+
+  //! read the box lo[d] <= i_d < hi[d] of the data file 'name' into 'out'
+  //
+  // only the tiles that intersect the box are read from disk.  'out' is
+  // dense, with the first dimension fastest.
+  void readRegion(const string & name,
+                  const std::vector<size_t> & lo,
+                  const std::vector<size_t> & hi,
+                  double * out) const;
+
+  const Ldrset & procs(size_t dim = 0) const;
+
+private:
+  string _procpath;
+  std::vector<Ldrset> _procs;
+  std::vector<size_t> _si;
+  std::vector<size_t> _xdim;
+  bru_dtype _dtype;
+  bool _swap;
+  double _scale;
+};
+
+#endif // PROCDATA_HPP
@@ -0,0 +1,276 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for TopSpin/ParaVision raw data: fid and ser
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <cmath>
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "rawdata.hpp"
+#include "ldrschema.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+// group delays for DSPFVS 10..13, indexed by DECIM.  from the bruker
+// dsp documentation, as used by most third party readers.
+static const struct {
+  int decim;
+  double delay[4];
+} g_dsp_table[] = {
+  {    2, { 44.75,              46.0,               46.0,               2.75               } },
+  {    3, { 33.5,               36.5,               36.5,               2.8333333333333333 } },
+  {    4, { 66.625,             48.0,               48.0,               2.875              } },
+  {    6, { 59.083333333333333, 50.166666666666667, 50.166666666666667, 2.9166666666666667 } },
+  {    8, { 68.5625,            53.25,              53.25,              2.9375             } },
+  {   12, { 60.375,             69.5,               69.5,               2.9583333333333333 } },
+  {   16, { 69.53125,           72.25,              71.625,             2.96875            } },
+  {   24, { 61.020833333333333, 70.166666666666667, 70.166666666666667, 2.9791666666666667 } },
+  {   32, { 70.015625,          72.75,              72.125,             2.984375           } },
+  {   48, { 61.34375,           70.5,               70.5,               2.9895833333333333 } },
+  {   64, { 70.2578125,         73.0,               72.375,             2.9921875          } },
+  {   96, { 61.505208333333333, 70.666666666666667, 70.666666666666667, 2.9947916666666667 } },
+  {  128, { 70.37890625,        72.5,               72.5,               0                  } },
+  {  192, { 61.5859375,         71.333333333333333, 71.333333333333333, 0                  } },
+  {  256, { 70.439453125,       72.25,              72.25,              0                  } },
+  {  384, { 61.626302083333333, 71.666666666666667, 71.666666666666667, 0                  } },
+  {  512, { 70.4697265625,      72.125,             72.125,             0                  } },
+  {  768, { 61.646484375,       71.833333333333333, 71.833333333333333, 0                  } },
+  { 1024, { 70.48486328125,     72.0625,            72.0625,            0                  } },
+  { 1536, { 61.656575520833333, 71.916666666666667, 71.916666666666667, 0                  } },
+  { 2048, { 70.492431640625,    72.03125,           72.03125,           0                  } },
+};
+
+// just the parts of acqus the reader uses, so an odd value in some other
+// label (ie. a textual AQ_mod) doesn't stop it
+struct RawAcqus
+{
+  int TD = 0, BYTORDA = 0, DTYPA = 0;
+};
+
+LDR_SCHEMA_BEGIN(RawAcqus, "acqus")
+  LDR_FIELD(TD), LDR_FIELD(BYTORDA), LDR_FIELD(DTYPA),
+LDR_SCHEMA_END()
+
+struct GrpdlyAcqus
+{
+  int DECIM = 0, DSPFVS = 0, DIGMOD = 0;
+  double GRPDLY = 0;
+};
+
+LDR_SCHEMA_BEGIN(GrpdlyAcqus, "acqus")
+  LDR_FIELD(DECIM), LDR_FIELD(DSPFVS), LDR_FIELD(DIGMOD), LDR_FIELD(GRPDLY),
+LDR_SCHEMA_END()
+
+double
+bru_group_delay(const Ldrset & acqus)
+{
+  GrpdlyAcqus pars;
+  LdrFound<GrpdlyAcqus> found = ldr_schema_load(acqus, pars);
+  if (pars.GRPDLY > 0)
+    return pars.GRPDLY;
+  if (pars.DIGMOD == 0)
+    return 0;
+  if (!found.has("DECIM") || !found.has("DSPFVS"))
+    return 0;
+
+  int decim = pars.DECIM;
+  int dspfvs = pars.DSPFVS;
+  if (dspfvs < 10 || dspfvs > 13) {
+    ERROR("bru_group_delay: no group delay known for DSPFVS=" << dspfvs);
+    return 0;
+  }
+  for (auto & entry : g_dsp_table)
+    if (entry.decim == decim && entry.delay[dspfvs - 10] > 0)
+      return entry.delay[dspfvs - 10];
+  ERROR("bru_group_delay: no group delay known for DECIM=" << decim << " DSPFVS=" << dspfvs);
+  return 0;
+}
+
+RawData::RawData(const string & exppath, grpdly_mode mode)
+{
+  TRACE_SPAN("RawData::open", exppath);
+  struct stat st;
+  _acqus.loadFile(exppath + "/acqus");
+  _datafile = exppath + "/ser";
+  if (stat(_datafile.c_str(), &st))
+    _datafile = exppath + "/fid";
+  init(mode);
+}
+
+RawData::RawData(const Ldrset & acqus, const string & datafile, grpdly_mode mode)
+  : _acqus(acqus), _datafile(datafile)
+{
+  init(mode);
+}
+
+void
+RawData::init(grpdly_mode mode)
+{
+  RawAcqus pars;
+  if (!ldr_schema_load(_acqus, pars).has("TD"))
+    throw std::out_of_range("RawData: no TD in acqus for " + _datafile);
+  int bytorder = pars.BYTORDA;
+  int dtype = pars.DTYPA;
+  if (dtype != BRU_INT32 && dtype != BRU_FLOAT64) {
+    stringstream str;
+    str << "RawData: " << _datafile << ": unsupported DTYPA=" << dtype;
+    throw std::invalid_argument(str.str());
+  }
+  _dtype = (bru_dtype)dtype;
+  _swap = (bytorder != 0) != bru_host_bigendian();
+  _td = (size_t)pars.TD / 2;
+  if (!_td)
+    throw std::invalid_argument("RawData: TD is 0 in acqus for " + _datafile);
+
+  // each FID in a ser file starts on a 1024 byte boundary.  a fid can hold
+  // several FIDs the same way (ie. paravision repetitions)
+  struct stat st;
+  size_t filesize = stat(_datafile.c_str(), &st) ? 0 : (size_t)st.st_size;
+  bool isser = _datafile.size() >= 3 && _datafile.compare(_datafile.size() - 3, 3, "ser") == 0;
+  size_t bytes = _td * 2 * bru_dtype_size(_dtype);
+  // a fid shorter than TD (a stopped acquisition) is one row of what's there
+  if (!isser && filesize < bytes && filesize >= 2 * bru_dtype_size(_dtype)) {
+    _td = filesize / (2 * bru_dtype_size(_dtype));
+    bytes = _td * 2 * bru_dtype_size(_dtype);
+  }
+  size_t padded = (bytes + 1023) & ~(size_t)1023;
+  _rowbytes = padded;
+  if (filesize % padded && !(filesize % bytes))
+    _rowbytes = bytes;
+
+  _mode = mode;
+  _grpdly = mode == GRPDLY_NONE ? 0 : bru_group_delay(_acqus);
+  _skip = std::min((size_t)std::floor(_grpdly + 0.5), _td);
+  if (mode == GRPDLY_SHIFT)
+    _skip = std::min((size_t)std::floor(_grpdly), _td);
+  _points = mode == GRPDLY_TRUNCATE ? _td - _skip : _td;
+}
+
+size_t
+RawData::rows() const
+{
+  struct stat st;
+  if (stat(_datafile.c_str(), &st))
+    return 0;
+  return rowsIn((size_t)st.st_size);
+}
+
+size_t
+RawData::rowsIn(size_t filesize) const
+{
+  size_t bytes = _td * 2 * bru_dtype_size(_dtype);
+  // a partial last row (acquisition in progress) doesn't count
+  size_t rows = filesize / _rowbytes;
+  if (bytes && filesize - rows * _rowbytes >= bytes)
+    rows++;
+  return rows;
+}
+
+size_t
+RawData::points() const
+{
+  return _points;
+}
+
+size_t
+RawData::tdPoints() const
+{
+  return _td;
+}
+
+size_t
+RawData::rowBytes() const
+{
+  return _rowbytes;
+}
+
+double
+RawData::groupDelay() const
+{
+  return _grpdly;
+}
+
+double
+RawData::residualDelay() const
+{
+  return _grpdly - (double)_skip;
+}
+
+const string &
+RawData::dataFile() const
+{
+  return _datafile;
+}
+
+const Ldrset &
+RawData::acqus() const
+{
+  return _acqus;
+}
+
+void
+RawData::convertRow(const uint8_t * src, std::complex<double> * out) const
+{
+  // complex<double> is layout compatible with double[2]
+  const size_t esz = 2 * bru_dtype_size(_dtype);
+  double * dst = reinterpret_cast<double *>(out);
+  switch (_mode) {
+  case GRPDLY_NONE:
+    bru_convert(src, _dtype, _swap, 2 * _td, dst);
+    break;
+  case GRPDLY_SHIFT:
+    bru_convert(src + _skip * esz, _dtype, _swap, 2 * (_td - _skip), dst);
+    bru_convert(src, _dtype, _swap, 2 * _skip, dst + 2 * (_td - _skip));
+    break;
+  case GRPDLY_TRUNCATE:
+    bru_convert(src + _skip * esz, _dtype, _swap, 2 * (_td - _skip), dst);
+    break;
+  }
+}
+
+void
+RawData::readRows(size_t first, size_t count, std::complex<double> * out, unsigned nthreads) const
+{
+  TRACE_SPAN("RawData::read", _datafile);
+  MappedFile data(_datafile);
+  const size_t bytes = _td * 2 * bru_dtype_size(_dtype);
+  if (count && data.size() < (first + count - 1) * _rowbytes + bytes) {
+    stringstream str;
+    str << "RawData: " << _datafile << " is too short for rows ["
+        << first << "," << first + count << ")";
+    throw std::out_of_range(str.str());
+  }
+  parallel_for(count, [&](size_t rr) {
+      convertRow(data.data() + (first + rr) * _rowbytes, out + rr * _points);
+    }, nthreads);
+}
+
+void
+RawData::read(std::complex<double> * out, unsigned nthreads) const
+{
+  readRows(0, rows(), out, nthreads);
+}
+
+void
+RawData::read(double * re, double * im, unsigned nthreads) const
+{
+  MappedFile data(_datafile);
+  read(data, re, im, nthreads);
+}
+
+void
+RawData::read(const MappedFile & data, double * re, double * im, unsigned nthreads) const
+{
+  TRACE_SPAN("RawData::read", _datafile);
+  size_t nrows = rowsIn(data.size());
+  parallel_for(nrows, [&](size_t rr) {
+      std::vector<std::complex<double> > row(_td);
+      convertRow(data.data() + rr * _rowbytes, &row[0]);
+      for (size_t ii = 0; ii < _points; ii++) {
+        re[rr * _points + ii] = row[ii].real();
+        im[rr * _points + ii] = row[ii].imag();
+      }
+    }, nthreads);
+}
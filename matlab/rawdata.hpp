@@ -0,0 +1,87 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for TopSpin/ParaVision raw data: fid and ser
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Bruker's digital receivers prepend a filter group delay to every FID.
+// The delay is GRPDLY in acqus, or for older systems is looked up from
+// DECIM and DSPFVS.  It can be removed while the data is converted:
+//
+//  GRPDLY_SHIFT    - rotate the integer part of the delay to the end of
+//                    each row, the fractional remainder (residualDelay())
+//                    is left for a first-order phase ramp on the spectrum
+//  GRPDLY_TRUNCATE - drop the first round(GRPDLY) points of each row
+//
+#ifndef RAWDATA_HPP
+#define RAWDATA_HPP
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "jcampdx.hpp"
+#include "bruio.hpp"
+
+enum grpdly_mode {
+  GRPDLY_NONE,
+  GRPDLY_SHIFT,
+  GRPDLY_TRUNCATE,
+};
+
+//! digital filter group delay in (complex) points, 0 for analog data
+double bru_group_delay(const Ldrset & acqus);
+
+class RawData
+{
+public:
+  //! the acqus and fid or ser in the experiment directory 'exppath'
+  RawData(const string & exppath, grpdly_mode mode = GRPDLY_NONE);
+  //! an already-loaded acqus and the raw data file 'datafile'
+  RawData(const Ldrset & acqus, const string & datafile, grpdly_mode mode = GRPDLY_NONE);
+
+  //! number of complete FIDs in the file now
+  size_t rows() const;
+  //! number of complete FIDs in the first 'filesize' bytes of the file
+  size_t rowsIn(size_t filesize) const;
+  //! complex points per row of output, after group delay removal
+  size_t points() const;
+  //! complex points per row stored on disk, TD/2 (less for a short fid)
+  size_t tdPoints() const;
+  //! bytes per row on disk, including any block padding
+  size_t rowBytes() const;
+  //! the group delay in points, and what's left after removing whole points
+  double groupDelay() const;
+  double residualDelay() const;
+  const Ldrset & acqus() const;
+  //! the fid or ser
+  const string & dataFile() const;
+
+  //! read all rows into 'out' (rows() x points()), rows in parallel
+  void read(std::complex<double> * out, unsigned nthreads = 0) const;
+  //! read all rows into separate real & imaginary arrays
+  void read(double * re, double * im, unsigned nthreads = 0) const;
+  //! read the rows complete in 'data', a mapping of dataFile(), into
+  //! rowsIn(data.size()) x points() real & imaginary arrays.  the way to
+  //! size the output for a file that's still growing
+  void read(const MappedFile & data, double * re, double * im, unsigned nthreads = 0) const;
+  //! read rows [first, first+count)
+  void readRows(size_t first, size_t count, std::complex<double> * out, unsigned nthreads = 0) const;
+  //! convert one row from its on-disk bytes 'src' into 'out'
+  void convertRow(const uint8_t * src, std::complex<double> * out) const;
+
+private:
+  void init(grpdly_mode mode);
+
+  Ldrset _acqus;
+  string _datafile;
+  bru_dtype _dtype;
+  bool _swap;
+  size_t _td;
+  size_t _rowbytes;
+  size_t _skip;
+  size_t _points;
+  grpdly_mode _mode;
+  double _grpdly;
+};
+
+#endif // RAWDATA_HPP
@@ -1,7 +1,14 @@
-function A = read_bru_experiment(PathName)
+function A = read_bru_experiment(PathName, grpdly)
 %
 % read bruker experiment and saved processed data
 %
+% grpdly: optional digital filter group delay removal for the fid/ser,
+%   'none' (default), 'shift' (rotate to end of each fid, the fractional
+%   remainder in points is returned in A.grpdly_residual), or 'truncate'
+%
+if nargin < 2
+    grpdly = 'none';
+end
 
 %% read various parameter files
 jdxfiles = {'proc' 'procs' 'proc2' 'proc2s'...
@@ -65,7 +72,11 @@ for jj=1:length(pdatadirs)
 end
 
 %% read the raw data
-if exist([PathName '/fid'])
+if (exist([PathName '/fid']) || exist([PathName '/ser'])) && isfield(A, 'acqus')
+    % ser comes back as TD/2 x rows
+    [A.fid, A.grpdly_residual] = mexrawdata(PathName, grpdly);
+    A.fid = conj(A.fid);
+elseif exist([PathName '/fid'])
     fpre = fopen([PathName '/fid'],'r');
     A.fid = fread(fpre,'int32','l');
     A.fid = A.fid(1:2:end) - 1i * A.fid(2:2:end);
@@ -84,44 +95,47 @@ if exist([PathName '/pulseprogram'])
     fclose(fp);
 end
 
-if exist([PathName '/ser'])
-    fpre = fopen([PathName '/ser'],'r');
-    A.fid = fread(fpre,'int32','l');
-    A.fid = A.fid(1:2:end) - 1i * A.fid(2:2:end);
-    if isfield(A.acqus, 'TD')
-        A.fid = reshape(A.fid, A.acqus.TD/2, []);
-    end
-    fclose(fpre);
-end
-    
 if exist([PathName '/vdlist'])
     A.vdlist = read_bru_delaylist([PathName '/vdlist']);
 end
 if exist([PathName '/vclist'])
     A.vclist = read_bru_delaylist([PathName '/vclist']);
 end
+if exist([PathName '/vplist'])
+    A.vplist = read_bru_delaylist([PathName '/vplist'], 1e-6);
+end
+for jj=1:8
+    fqlist = sprintf('fq%dlist', jj);
+    if exist([PathName '/' fqlist])
+        A.(fqlist) = mexbrulist([PathName '/' fqlist], 1, 'fq');
+    end
+end
 
+% processed data, de-tiled and scaled by NC_proc in mexpdata
 if exist([PathName '/1r'])
-    fpre = fopen([PathName '/1r'],'r');
-    fpim = fopen([PathName '/1i'],'r');
-    A.spec = fread(fpre,'int32') + 1i * fread(fpim,'int32');
-    % scale the spectrum according to NC_proc (going from 32-bit int to 64-bit double anyway)
-    A.spec = A.spec .* (2^A.procs.NC_proc);
-    fclose(fpre);
-    fclose(fpim);
+    A.spec = mexpdata(PathName, '1r');
+    if exist([PathName '/1i'])
+        A.spec = A.spec + 1i * mexpdata(PathName, '1i');
+    end
 end
 
 if exist([PathName '/2rr'])
-    fpre = fopen([PathName '/2rr'],'r');
-    fpim = fopen([PathName '/2ii'],'r');
-    A.spec = fread(fpre,'int32') + 1i * fread(fpim,'int32');
-    % scale the spectrum according to NC_proc (going from 32-bit int to 64-bit double anyway)
-    A.spec = A.spec .* (2^A.procs.NC_proc);
-    fclose(fpre);
-    fclose(fpim);
-    % should reshape A.spec here, but how?  maybe...?
-    warning('shape of 2D .spec might be wrong');
-    A.spec = reshape(A.spec, [], A.procs.TDeff).';
+    A.spec = mexpdata(PathName, '2rr');
+    if exist([PathName '/2ii'])
+        A.spec = A.spec + 1i * mexpdata(PathName, '2ii');
+    end
+    % rows are F1, columns F2
+    A.spec = A.spec.';
+end
+
+if exist([PathName '/2dseq']) && isfield(A, 'visu_pars')
+    % reconstructed image, VisuCoreSize x frame groups
+    A.image = mex2dseq(PathName);
+end
+
+if exist([PathName '/3rrr'])
+    % dimensions are F3 x F2 x F1
+    A.spec = mexpdata(PathName, '3rrr');
 end
 
 for FILE = {'acqus' 'procs'}
@@ -0,0 +1,20 @@
+#!/bin/bash
+#
+# allocation regression check: benchmark the reader on the synthetic corpus
+# and fail if any call makes more allocations per LDR than its budget.
+# lower a budget when an allocation improvement lands, so it stays landed.
+# extra arguments go to jcampbench (ie. -o results.json)
+#
+
+if [ ! -x jcampbench -o jcampbench.cpp -nt jcampbench -o jcampdx.cpp -nt jcampbench ]; then
+    g++ -std=c++11 -O2 -pthread jcampbench.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp -o jcampbench || exit 1
+fi
+
+# allocations per LDR (per label for getLdr & mexldr)
+exec ./jcampbench -r 2 "$@" \
+     -B loadFile=35 \
+     -B loadString=35 \
+     -B getLdr=0 \
+     -B acqus/schema=0 \
+     -B 'operator<<=0.1' \
+     -B mexldr=4
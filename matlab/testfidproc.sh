@@ -0,0 +1,36 @@
+#!/bin/bash
+#
+# process the fid of every 1D topspin example experiment with fidproc and
+# compare it with the 1r/1i topspin wrote, fail if any differ by more than
+# the tolerance.  fidproc phases one way only (see FidProcessor), a phase
+# convention topspin doesn't share fails here.  arguments are experiment
+# directories, else the examdata.
+# -t tol sets the relative rms difference allowed (0.01)
+#
+
+export XWINNMRHOME=${XWINNMRHOME:-/opt/topspin}
+
+tol=0.01
+if [ "$1" = "-t" ]; then
+    tol=$2
+    shift 2
+fi
+
+exps="$@"
+if [ -z "$exps" ]; then
+    exps=$(ls -d $XWINNMRHOME/examdata/*/*/[0-9]* $XWINNMRHOME/examdata/*/[0-9]* 2>/dev/null)
+fi
+
+if [ ! -x fidproc -o fidproc.cpp -nt fidproc ]; then
+    g++ -std=c++11 -O2 -pthread -DFIDPROC_MAIN -o fidproc fidproc.cpp procdata.cpp rawdata.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp || exit 1
+fi
+
+failed=0
+checked=0
+for exp in $exps; do
+    [ -f $exp/fid -a -f $exp/pdata/1/1r -a -f $exp/pdata/1/1i ] || continue
+    checked=$((checked + 1))
+    ./fidproc -t $tol $exp 1 || failed=$((failed + 1))
+done
+echo "$checked experiments, $failed differ from topspin"
+[ $checked -gt 0 -a $failed -eq 0 ]
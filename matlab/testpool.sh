@@ -0,0 +1,27 @@
+#!/bin/bash
+#
+# pooled set check: parse jcamp-dx files from many threads into one LdrPool
+# under AddressSanitizer, and fail if a getLdr() reference goes stale or a
+# change to one set shows up in another.  arguments are files, else the
+# parameter files of some example experiments.  extra options go to
+# jcampstress (ie. -t 8)
+#
+
+export XWINNMRHOME=${XWINNMRHOME:-/opt/topspin}
+
+opts=
+while [ "${1:0:1}" = "-" ]; do
+    opts="$opts $1 $2"
+    shift 2
+done
+
+files="$@"
+if [ -z "$files" ]; then
+    files=$(ls $XWINNMRHOME/examdata/*/*/[0-9]*/{acqus,acqu2s,pdata/1/procs} 2>/dev/null)
+fi
+
+if [ ! -x jcampstress_asan -o jcampstress.cpp -nt jcampstress_asan -o jcampdx.cpp -nt jcampstress_asan ]; then
+    g++ -std=c++11 -O1 -g -pthread -fsanitize=address -o jcampstress_asan jcampstress.cpp jcampdx.cpp jcamp_parse.cpp jcamp_scan.cpp FileLoc.cpp || exit 1
+fi
+
+exec ./jcampstress_asan -p $opts $files
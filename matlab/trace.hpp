@@ -0,0 +1,244 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// scoped trace spans, written out as chrome trace-event json
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// Set BRUKITCHEN_TRACE=/some/trace.json and every TRACE_SPAN in the process
+// is recorded, then appended to that file at exit (and whenever
+// Trace::flush() is called, which the mex functions do after every call).
+// mex files don't flush at exit, matlab may have unloaded them by then.
+// Load the file in chrome://tracing or ui.perfetto.dev for a flame chart.
+// The file is in the json array format without the closing ], so several
+// processes or mex calls can append to the same one.
+//
+// Spans go into a ring buffer per thread, the newest BRUKITCHEN_TRACE_EVENTS
+// (16384) since the last flush are kept.  Unless tracing is on, a span is
+// one relaxed atomic load.  Names must be literals; the detail (ie. a file
+// name) is copied, its last 47 characters.
+//
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#define TRACE_GETPID _getpid
+#else
+#include <unistd.h>
+#define TRACE_GETPID getpid
+#endif
+
+class Trace
+{
+public:
+  //! true if spans are being recorded
+  static bool enabled()
+  {
+    int state = on().load(std::memory_order_relaxed);
+    if (state < 0)
+      state = init();
+    return state > 0;
+  }
+
+  //! start (or with "" stop) recording, flushing to 'filename'
+  static void enable(const std::string & filename)
+  {
+    std::lock_guard<std::mutex> lock(mutex());
+    path() = filename;
+    on().store(!filename.empty(), std::memory_order_relaxed);
+  }
+
+  static uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  //! make this thread's ring now, so it isn't timed in the first span
+  static void prepare() { mine(); }
+
+  static void record(const char * name, const char * detail, uint64_t start, uint64_t end)
+  {
+    Ring & ring = mine();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Event & ev = ring.events[head % ring.events.size()];
+    ev.name = name;
+    ev.start = start;
+    ev.end = end;
+    ev.detail[0] = '\0';
+    if (detail) {
+      size_t len = strlen(detail);
+      if (len >= sizeof(ev.detail))
+        detail += len - (sizeof(ev.detail) - 1);
+      strncpy(ev.detail, detail, sizeof(ev.detail) - 1);
+      ev.detail[sizeof(ev.detail) - 1] = '\0';
+    }
+    ring.head.store(head + 1, std::memory_order_release);
+  }
+
+  //! append what has been recorded since the last flush to the trace file
+  //
+  // spans recorded while this runs may be torn, flush when things are quiet
+  static void flush()
+  {
+    std::lock_guard<std::mutex> lock(mutex());
+    if (path().empty())
+      return;
+    FILE * fp = fopen(path().c_str(), "a");
+    if (!fp)
+      return;
+    fseek(fp, 0, SEEK_END);
+    if (ftell(fp) == 0)
+      fputs("[\n", fp);
+    int pid = (int)TRACE_GETPID();
+    for (auto & ring : rings()) {
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      uint64_t first = ring->flushed;
+      if (head - first > ring->events.size())
+        first = head - ring->events.size();
+      for (uint64_t ii = first; ii < head; ii++) {
+        const Event & ev = ring->events[ii % ring->events.size()];
+        fprintf(fp, "{\"name\":\"%s\",\"cat\":\"brukitchen\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":%d,\"tid\":%u", ev.name, ev.start / 1e3, (ev.end - ev.start) / 1e3,
+                pid, ring->tid);
+        if (ev.detail[0]) {
+          fputs(",\"args\":{\"detail\":\"", fp);
+          for (const char * cc = ev.detail; *cc; cc++)
+            if (*cc == '"' || *cc == '\\')
+              fprintf(fp, "\\%c", *cc);
+            else if ((unsigned char)*cc >= ' ')
+              fputc(*cc, fp);
+          fputs("\"}", fp);
+        }
+        fputs("},\n", fp);
+      }
+      ring->flushed = head;
+    }
+    fclose(fp);
+  }
+
+private:
+  struct Event {
+    const char * name;
+    uint64_t start, end;
+    char detail[48];
+  };
+
+  struct Ring {
+    Ring(size_t size, unsigned id) : events(size), head(0), flushed(0), tid(id) {}
+    std::vector<Event> events;
+    std::atomic<uint64_t> head;
+    uint64_t flushed;   //!< under mutex()
+    unsigned tid;
+  };
+
+  static int init()
+  {
+    std::lock_guard<std::mutex> lock(mutex());
+    int state = on().load();
+    if (state >= 0)
+      return state;
+    rings();
+    const char * env = getenv("BRUKITCHEN_TRACE");
+    if (env && *env) {
+      path() = env;
+#ifndef MATLAB_MEX_FILE
+      atexit(flush);
+#endif
+    }
+    state = !path().empty();
+    on().store(state);
+    return state;
+  }
+
+  // this thread's ring, made the first time it records
+  static Ring & mine()
+  {
+    thread_local std::shared_ptr<Ring> ring;
+    if (!ring) {
+      const char * env = getenv("BRUKITCHEN_TRACE_EVENTS");
+      long size = env ? atol(env) : 0;
+      std::lock_guard<std::mutex> lock(mutex());
+      ring = std::make_shared<Ring>(size > 0 ? (size_t)size : 16384, (unsigned)rings().size() + 1);
+      rings().push_back(ring);
+    }
+    return *ring;
+  }
+
+  static std::atomic<int> & on()
+  {
+    static std::atomic<int> state(-1);
+    return state;
+  }
+  static std::string & path()
+  {
+    static std::string filename;
+    return filename;
+  }
+  // kept after their threads exit, until the process does
+  static std::vector<std::shared_ptr<Ring> > & rings()
+  {
+    static std::vector<std::shared_ptr<Ring> > all;
+    return all;
+  }
+  static std::mutex & mutex()
+  {
+    static std::mutex mtx;
+    return mtx;
+  }
+};
+
+//! records the time from its construction to its destruction, if tracing is on
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char * name)
+    : _name(Trace::enabled() ? name : NULL), _start(0)
+  {
+    if (_name) {
+      Trace::prepare();
+      _start = Trace::now();
+    }
+  }
+  TraceSpan(const char * name, const std::string & detail)
+    : TraceSpan(name)
+  {
+    if (_name)
+      _detail = detail;
+  }
+  ~TraceSpan()
+  {
+    if (_name)
+      Trace::record(_name, _detail.c_str(), _start, Trace::now());
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan & operator=(const TraceSpan &) = delete;
+
+private:
+  const char * _name;
+  std::string _detail;
+  uint64_t _start;
+};
+
+//! flushes the trace when it goes out of scope, declare it before the spans
+struct TraceFlush
+{
+  ~TraceFlush() { if (Trace::enabled()) Trace::flush(); }
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+//! TRACE_SPAN("name") or TRACE_SPAN("name", detail) for the rest of the scope
+#define TRACE_SPAN(...) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(__VA_ARGS__)
+
+#endif // TRACE_HPP
@@ -0,0 +1,147 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for ParaVision reconstructed images (2dseq), described by visu_pars
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#include <algorithm>
+
+#include "visudata.hpp"
+#include "ldrschema.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+
+VisuData::VisuData(const string & procpath)
+  : _seqfile(procpath + "/2dseq")
+{
+  Ldrset visu_pars(procpath + "/visu_pars");
+  init(visu_pars);
+}
+
+VisuData::VisuData(const Ldrset & visu_pars, const string & seqfile)
+  : _seqfile(seqfile)
+{
+  init(visu_pars);
+}
+
+void
+VisuData::init(const Ldrset & visu_pars)
+{
+  TRACE_SPAN("VisuData::open", _seqfile);
+  VisuCore visu;
+  LdrFound<VisuCore> found = ldr_schema_load(visu_pars, visu);
+  if (!found.has("VisuCoreWordType") || !found.has("VisuCoreSize"))
+    throw std::out_of_range("VisuData: no VisuCoreWordType or VisuCoreSize for " + _seqfile);
+  const string & wordtype = visu.VisuCoreWordType;
+  if (wordtype == "_32BIT_SGN_INT")
+    _dtype = BRU_INT32;
+  else if (wordtype == "_16BIT_SGN_INT")
+    _dtype = BRU_INT16;
+  else if (wordtype == "_8BIT_UNSGN_INT")
+    _dtype = BRU_UINT8;
+  else if (wordtype == "_32BIT_FLOAT")
+    _dtype = BRU_FLOAT32;
+  else
+    throw std::invalid_argument("VisuData: unknown VisuCoreWordType: '" + wordtype + "'");
+
+  bool bigendian = visu.VisuCoreByteOrder == "bigEndian";
+  _swap = bigendian != bru_host_bigendian();
+
+  for (int size : visu.VisuCoreSize)
+    _coresize.push_back((size_t)size);
+
+  _framecount = (size_t)visu.VisuCoreFrameCount;
+
+  // frame groups: (len, <id>, <comment>, valsStart, valsCnt)
+  size_t fgframes = 1;
+  if (visu_pars.labelExists("VisuFGOrderDesc")) {
+    const Ldr & fgdesc = visu_pars.getLdr("VisuFGOrderDesc");
+    for (size_t ii = 0; ii < fgdesc.size(); ii++) {
+      if (fgdesc.type(ii) != RECORD_GROUP)
+        continue;
+      const Ldr & fg = fgdesc.group(ii);
+      _fglen.push_back((size_t)fg.num(0));
+      _fgid.push_back(fg.size() > 1 ? fg.str(1) : "");
+      fgframes *= _fglen.back();
+    }
+  }
+  if (fgframes != _framecount) {
+    _fglen.assign(1, _framecount);
+    _fgid.assign(1, "");
+  }
+
+  // one per frame, or fewer with the last repeated
+  const std::vector<double> & slope = visu.VisuCoreDataSlope;
+  const std::vector<double> & offs = visu.VisuCoreDataOffs;
+  for (size_t ii = 0; ii < _framecount; ii++) {
+    _slope.push_back(slope.empty() ? 1 : slope[std::min(ii, slope.size() - 1)]);
+    _offs.push_back(offs.empty() ? 0 : offs[std::min(ii, offs.size() - 1)]);
+  }
+}
+
+std::vector<size_t>
+VisuData::shape() const
+{
+  std::vector<size_t> shape(_coresize);
+  shape.insert(shape.end(), _fglen.begin(), _fglen.end());
+  return shape;
+}
+
+size_t
+VisuData::frameSize() const
+{
+  size_t n = 1;
+  for (auto sz : _coresize)
+    n *= sz;
+  return n;
+}
+
+size_t
+VisuData::frameCount() const
+{
+  return _framecount;
+}
+
+const std::vector<string> &
+VisuData::frameGroups() const
+{
+  return _fgid;
+}
+
+template <typename T>
+void
+VisuData::readT(T * out, unsigned nthreads) const
+{
+  TRACE_SPAN("VisuData::read", _seqfile);
+  MappedFile seq(_seqfile);
+  const size_t framepts = frameSize();
+  const size_t framebytes = framepts * bru_dtype_size(_dtype);
+  if (seq.size() < framebytes * _framecount) {
+    stringstream str;
+    str << "VisuData: " << _seqfile << " is " << seq.size() << " bytes, expected "
+        << framebytes * _framecount;
+    throw std::runtime_error(str.str());
+  }
+
+  // split frames into chunks of at least ~1MB so that small frames
+  // don't drown in scheduling overhead
+  const size_t chunk = std::max<size_t>(1, (1 << 20) / std::max<size_t>(1, framebytes));
+  const size_t nchunks = (_framecount + chunk - 1) / chunk;
+  parallel_for(nchunks, [&](size_t cc) {
+      for (size_t ff = cc * chunk; ff < std::min(_framecount, (cc + 1) * chunk); ff++)
+        bru_convert(seq.data() + ff * framebytes, _dtype, _swap, framepts,
+                    out + ff * framepts, _slope[ff], _offs[ff]);
+    }, nthreads);
+}
+
+void
+VisuData::read(float * out, unsigned nthreads) const
+{
+  readT(out, nthreads);
+}
+
+void
+VisuData::read(double * out, unsigned nthreads) const
+{
+  readT(out, nthreads);
+}
@@ -0,0 +1,56 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// reader for ParaVision reconstructed images (2dseq), described by visu_pars
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+#ifndef VISUDATA_HPP
+#define VISUDATA_HPP
+
+#include <string>
+#include <vector>
+#include "jcampdx.hpp"
+#include "bruio.hpp"
+
+class VisuData
+{
+public:
+  //! use the visu_pars and 2dseq in the directory 'procpath'
+  VisuData(const string & procpath);
+  //! use an already-loaded visu_pars with the image file 'seqfile'
+  VisuData(const Ldrset & visu_pars, const string & seqfile);
+
+  //! VisuCoreSize followed by the frame group lengths, first dimension fastest
+  //
+  // if the frame groups don't describe VisuCoreFrameCount, the frames
+  // are a single trailing dimension.
+  std::vector<size_t> shape() const;
+  //! number of pixels in one frame, the product of VisuCoreSize
+  size_t frameSize() const;
+  size_t frameCount() const;
+  //! frame group ids (ie FG_SLICE, FG_ECHO), in the order of shape()
+  const std::vector<string> & frameGroups() const;
+
+  //! read the whole image and apply the per-frame slope & offset
+  //
+  // 'out' must hold frameSize() * frameCount() values.  frames are
+  // converted in parallel on 'nthreads' threads (0 = all).
+  void read(float * out, unsigned nthreads = 0) const;
+  void read(double * out, unsigned nthreads = 0) const;
+
+private:
+  void init(const Ldrset & visu_pars);
+  template <typename T> void readT(T * out, unsigned nthreads) const;
+
+  string _seqfile;
+  std::vector<size_t> _coresize;
+  size_t _framecount;
+  std::vector<size_t> _fglen;
+  std::vector<string> _fgid;
+  std::vector<double> _slope;
+  std::vector<double> _offs;
+  bru_dtype _dtype;
+  bool _swap;
+};
+
+#endif // VISUDATA_HPP
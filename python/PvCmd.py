@@ -24,10 +24,19 @@ etc.  Attributes to the object are the method's parameters.
 '''
 
 import os
+import sys
 import time
+import Queue
+import pipes
 import logging
+import threading
 import subprocess
 
+try:
+    import jcampdx
+except ImportError:
+    jcampdx = None
+
 def is_exe(fpath):
     ''' helper function '''
     return os.path.isfile(fpath) and os.access(fpath, os.X_OK)
@@ -54,6 +63,15 @@ class PvObj(object):
     o.Gop()
     o.Go()
 
+    Parameter values are cached in the object until it is changed through
+    it (SetParam, Start, Gop, Gsp, Undo...), GetParams() reads several at
+    once.
+
+    Operations can be queued to run in the background, one after the other:
+    f1 = o1.Submit('Start', wait=True)
+    f2 = o2.Submit('Start', wait=True)
+    ... look at earlier results while o1 and o2 are acquired ...
+    f2.result()
     '''
 
     def __init__(self, objpath, pvScan):
@@ -68,6 +86,8 @@ class PvObj(object):
         #    raise AttributeError("invalid object path no acqp: '%s'".format(objpath))
         self.__dict__['_objpath'] = objpath
         self.__dict__['_pvScan'] = pvScan
+        self.__dict__['_params'] = {}
+        self.__dict__['_disk'] = (None, {})   # (file states, DiskParams())
         self.__dict__['log'] = logging.getLogger('PvObj[%s]' % objpath)
 
     def __str__(self):
@@ -98,12 +118,87 @@ class PvObj(object):
         return not result
 
     def GetParam(self, name):
-        self._pvScan.SetObj(self)
-        return self._pvScan.GetParam(name)
+        if name in self._params:
+            return self._params[name]
+        disk = self.DiskParams()
+        if name in disk:
+            return disk[name]
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            value = self._pvScan.GetParam(name)
+        self._params[name] = value
+        return value
+
+    def GetParams(self, names):
+        ''' get several parameters at once, as a {name: value} dict '''
+        missing = [name for name in names if name not in self._params]
+        disk = self.DiskParams() if missing else {}
+        missing = [name for name in missing if name not in disk]
+        if missing:
+            with self._pvScan.lock:
+                self._pvScan.SetObj(self)
+                values = self._pvScan.GetParams(missing)
+            self._params.update(values)
+        return dict((name, self._params[name] if name in self._params else disk[name])
+                    for name in names)
+
+    def DiskParams(self):
+        '''
+        the parameters of a completed scan, read from its acqp, method, reco
+        and visu_pars files, or {} if the scan isn't complete (or jcampdx
+        isn't available) and pv has to be asked.  kept until one of the
+        files changes
+        '''
+        if jcampdx is None:
+            return {}
+        acqpfile = self.ExpPath() + '/acqp'
+        filenames = [self.ProcPath() + '/visu_pars', self.ProcPath() + '/reco',
+                     self.ExpPath() + '/method']
+        state = tuple(file_state(filename) for filename in [acqpfile] + filenames)
+        if state == self._disk[0]:
+            return self._disk[1]
+        acqp = read_params(acqpfile)
+        params = {}
+        if acqp.get('ACQ_completed') == 'Yes':
+            for filename in filenames:
+                params.update(read_params(filename))
+            params.update(acqp)
+        self.__dict__['_disk'] = (state, params)
+        return params
 
     def SetParam(self, name, value):
-        self._pvScan.SetObj(self)
-        self._pvScan.SetParam(name, value)
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.SetParam(name, value)
+        # the method may have changed other parameters too
+        self.Invalidate()
+
+    def Invalidate(self):
+        ''' forget cached parameter values, they'll be re-read from pv '''
+        self._params.clear()
+
+    def Submit(self, op, *args, **kwargs):
+        '''
+        queue the operation 'op' (ie 'Start', 'Adjustment') to run in the
+        background, returns a PvFuture
+        '''
+        return self._pvScan.Submit(getattr(self, op), *args, **kwargs)
+
+    def IsCompleted(self):
+        ''' has the scan been acquired? from the acqp file when possible '''
+        acqp = read_params(self.ExpPath() + '/acqp')
+        if acqp:
+            return acqp.get('ACQ_completed') == 'Yes'
+        self.Invalidate()
+        return self.GetParam('ACQ_completed') == 'Yes'
+
+    def WaitCompleted(self, timeout=None):
+        ''' wait until the scan has been acquired, False if 'timeout' passes first '''
+        return wait_for(self.IsCompleted, timeout)
+
+    def WaitQuiet(self, settle=2.0, timeout=None):
+        ''' wait until nothing in the experiment directory has changed for 'settle' seconds '''
+        return wait_quiet(self.ExpPath(), settle, timeout)
 
     def ProcPath(self):
         ''' the path to the object's reconstruction '''
@@ -120,18 +215,20 @@ class PvObj(object):
     def Clone(self):
         ''' clone the object described by pvobj, return the new PvObj '''
         self.log.info('Clone')
-        self._pvScan.SetObj(self)
-        # maybe... ?   -procno <path> : prono path to clone. -- untested
-        self._pvScan.Command('pvDsetClone', 'Scan', 'Current')
-        return self._pvScan.GetObj()
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            # maybe... ?   -procno <path> : prono path to clone. -- untested
+            self._pvScan.Command('pvDsetClone', 'Scan', 'Current')
+            return self._pvScan.GetObj()
 
     def CloneReco(self):
         ''' clone the object described by pvobj, return the new PvObj '''
         self.log.info('CloneReco')
-        self._pvScan.SetObj(self)
-        self._pvScan.Command('pvDsetClone', 'Reco', 'Current')
-        #pvScan pvDsetCloneProcno -procno path 0
-        return self._pvScan.GetObj()
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.Command('pvDsetClone', 'Reco', 'Current')
+            #pvScan pvDsetCloneProcno -procno path 0
+            return self._pvScan.GetObj()
 
     def RemoveFromList(self):
         self._pvScan.Command('pvDsetObjListRemove', self._objpath)
@@ -144,18 +241,21 @@ class PvObj(object):
 
     def ExportToTopspin(self):
         self.log.info('ExportToTopspin')
-        self._pvScan.SetObj(self)
-        self._pvScan.Command('pvDsetExport')
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.Command('pvDsetExport')
 
     def Delete(self):
         self.log.info('Delete')
-        self._pvScan.SetObj(self)
-        self._pvScan.Command('pvDsetDel', 'Scan', 'Current', '-Control', '-Alt')
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.Command('pvDsetDel', 'Scan', 'Current', '-Control', '-Alt')
 
     def DeleteReco(self):
         self.log.info('DeleteReco')
-        self._pvScan.SetObj(self)
-        self._pvScan.Command('pvDsetDel', 'Reco', 'Current', '-Control', '-Alt')
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.Command('pvDsetDel', 'Reco', 'Current', '-Control', '-Alt')
 
     # todo:
     # pvcmd -a pvScan pvStartGsp
@@ -175,7 +275,7 @@ class PvObj(object):
     # pvcmd -a pvScan pvScanGedAccept
     # pvcmd -a pvScan pvScanGedRefresh
 
-    def Adjustment(self, adjustment, category='Standard'):
+    def Adjustment(self, adjustment, category='Standard', timeout=None):
         '''
         run an adjustment (calibration), one of:
         'RCVR'   - receiver gain
@@ -183,25 +283,41 @@ class PvObj(object):
         'SHIM'   - x,y,z shim
         'TRANSM' - reference transmitter gain
         from either category 'Standard' or 'Current'
+
+        returns once the study directory has stopped changing
         '''
         self.log.info('Adjustment(%s,%s)' % (adjustment, category))
         if adjustment not in ['RCVR', 'FREQ', 'SHIM', 'TRANSM']:
             raise ValueError('Adjustment must be "RCVR", "FREQ", or "SHIM"')
         if category not in ['Standard', 'Current']:
             raise ValueError('Adjustment Category must be "Standard" or "Current"')
-        self._pvScan.SetObj(self)
-        self._pvScan.Command('pvStartGsauto', '-cmd', adjustment+'_'+category)
-        time.sleep(10)
+        study = self.StudyPath()
+        before = dir_state(study, 2)
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.Command('pvStartGsauto', '-cmd', adjustment+'_'+category)
+        # wait for it to start writing, then for it to finish
+        if not wait_for(lambda: dir_state(study, 2) != before, 10):
+            self.log.warning('Adjustment: %s_%s not seen starting' % (adjustment, category))
+        if not wait_quiet(study, 2.0, timeout, 2):
+            raise PvTimeout('Adjustment: %s_%s still running' % (adjustment, category))
         self._pvScan.Sync(self._objpath)
+        self.Invalidate()
 
-    def Start(self):
+    def Start(self, wait=False, timeout=None):
         '''
         like clicking the Traffic Light button in the Scan Control window (i think?)
+
+        if 'wait', returns only once the scan is completed
         '''
         self.log.info('Start')
-        self._pvScan.SetObj(self)
-        self._pvScan.Command('pvStartScan', '-Control', '-Alt')
-        self._pvScan.Sync(self._objpath)
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.Command('pvStartScan', '-Control', '-Alt')
+            self._pvScan.Sync(self._objpath)
+        self.Invalidate()
+        if wait and not self.WaitCompleted(timeout):
+            raise PvTimeout('Start: %s not completed' % self._objpath)
 
     def Stop(self):
         '''
@@ -211,25 +327,35 @@ class PvObj(object):
         by the mouse click :{
         '''
         self.log.info('Stop')
-        #self._pvScan.Command('pvStopScan','-quiet')
-        self._pvScan.Command('pvStopMultiPipe')
-        self._pvScan.Command('pvStopPipe', self._objpath)
-        #self._pvScan.Command('pvStopScan')
-        self._pvScan.Sync(self._objpath)
-
-    def Gop(self):
+        with self._pvScan.lock:
+            #self._pvScan.Command('pvStopScan','-quiet')
+            self._pvScan.Command('pvStopMultiPipe')
+            self._pvScan.Command('pvStopPipe', self._objpath)
+            #self._pvScan.Command('pvStopScan')
+            self._pvScan.Sync(self._objpath)
+        self.Invalidate()
+
+    def Gop(self, wait=False, timeout=None):
         '''
         like clicking the GOP button in the Spectrometer Control Tool
+
+        if 'wait', returns only once the data has stopped changing
         '''
-        self._pvScan.Command('pvStartGop', self._objpath, '-Control', '-Alt')
-        self._pvScan.Sync(self._objpath)
+        with self._pvScan.lock:
+            self._pvScan.Command('pvStartGop', self._objpath, '-Control', '-Alt')
+            self._pvScan.Sync(self._objpath)
+        self.Invalidate()
+        if wait and not self.WaitQuiet(timeout=timeout):
+            raise PvTimeout('Gop: %s still running' % self._objpath)
 
     def Gsp(self):
         '''
         like clicking the GSP button in the Spectrometer Control Tool
         '''
-        self._pvScan.Command('pvStartGsp', self._objpath)
-        self._pvScan.Sync(self._objpath)
+        with self._pvScan.lock:
+            self._pvScan.Command('pvStartGsp', self._objpath)
+            self._pvScan.Sync(self._objpath)
+        self.Invalidate()
 
     def Undo(self, what='Scan'):
         '''
@@ -237,8 +363,10 @@ class PvObj(object):
         '''
         if what != 'Scan' and what != 'Reco':
             raise ValueError('Undo: what must be Scan or Reco')
-        self._pvScan.SetObj(self)
-        self._pvScan.Command('pvDsetUndo', what, 'Current', '-Control', '-Alt')
+        with self._pvScan.lock:
+            self._pvScan.SetObj(self)
+            self._pvScan.Command('pvDsetUndo', what, 'Current', '-Control', '-Alt')
+        self.Invalidate()
 
 # side note:
 '''
@@ -248,6 +376,138 @@ for s in `pvcmd -l` ; do echo "-- $s --"; pvcmd -a $s -r CmdList ; echo '' ;  do
 
 '''
 
+# filename -> (mtime, size, params)
+_param_files = {}
+
+def read_params(filename):
+    '''
+    the parameters in the jcamp-dx file 'filename' as a dict, converted like
+    pythify() does, cached until the file changes.  {} if it can't be read.
+    '''
+    if jcampdx is None:
+        return {}
+    try:
+        st = os.stat(filename)
+    except OSError:
+        _param_files.pop(filename, None)
+        return {}
+    cached = _param_files.get(filename)
+    if cached and cached[0:2] == (st.st_mtime, st.st_size):
+        return cached[2]
+    try:
+        ldrs = jcampdx.Ldrset(filename)
+        params = dict((k, pvvalue(v)) for k, v in ldrs.to_dict().items())
+    except Exception, ex:
+        logging.getLogger('PvCmd').warning('read_params(%s): %s' % (filename, ex))
+        params = {}
+    _param_files[filename] = (st.st_mtime, st.st_size, params)
+    return params
+
+def pvvalue(val):
+    ''' make a jcampdx value look like what pythify() makes of pvcmd's output '''
+    if isinstance(val, (list, tuple)):
+        return [pvvalue(x) for x in val]
+    if hasattr(val, 'tolist'):
+        return pvvalue(val.tolist())
+    if isinstance(val, float):
+        return floatify(val)
+    return val
+
+class PvTimeout(Exception):
+    ''' an operation didn't finish in time '''
+    pass
+
+def wait_for(test, timeout=None, interval=0.1, maxinterval=2.0):
+    '''
+    call test() with exponential backoff until it returns true, returns
+    False if 'timeout' seconds pass first
+    '''
+    start = time.time()
+    while not test():
+        if timeout is not None and time.time() - start > timeout:
+            return False
+        time.sleep(interval)
+        interval = min(interval * 2, maxinterval)
+    return True
+
+def file_state(filename):
+    ''' (mtime, size) of 'filename', None if it isn't there '''
+    try:
+        st = os.stat(filename)
+    except OSError:
+        return None
+    return (st.st_mtime, st.st_size)
+
+def dir_state(path, depth=1):
+    ''' {path: (mtime, size)} of everything under 'path', 'depth' levels down '''
+    state = {}
+    try:
+        names = os.listdir(path)
+    except OSError:
+        return state
+    for name in names:
+        fullname = os.path.join(path, name)
+        try:
+            st = os.stat(fullname)
+        except OSError:
+            continue
+        state[fullname] = (st.st_mtime, st.st_size)
+        if depth > 1 and os.path.isdir(fullname):
+            state.update(dir_state(fullname, depth - 1))
+    return state
+
+def wait_quiet(path, settle=2.0, timeout=None, depth=1):
+    ''' wait until nothing under 'path' has changed for 'settle' seconds '''
+    last = [dir_state(path, depth), time.time()]
+    def quiet():
+        state = dir_state(path, depth)
+        if state != last[0]:
+            last[:] = [state, time.time()]
+        return time.time() - last[1] >= settle
+    return wait_for(quiet, timeout, maxinterval=settle / 2)
+
+class PvFuture(object):
+    ''' the result of an operation queued with PvScan.Submit() '''
+    def __init__(self):
+        self._done = threading.Event()
+        self._result = None
+        self._exc_info = None
+        self._callbacks = []
+        self._lock = threading.Lock()
+
+    def done(self):
+        return self._done.is_set()
+
+    def result(self, timeout=None):
+        ''' wait for the operation, return its result or raise its exception '''
+        if not self._done.wait(timeout):
+            raise PvTimeout('PvFuture: still running')
+        if self._exc_info:
+            raise self._exc_info[0], self._exc_info[1], self._exc_info[2]
+        return self._result
+
+    def exception(self, timeout=None):
+        if not self._done.wait(timeout):
+            raise PvTimeout('PvFuture: still running')
+        return self._exc_info[1] if self._exc_info else None
+
+    def add_done_callback(self, fn):
+        ''' call fn(future) when done, from the queue's thread '''
+        with self._lock:
+            if not self._done.is_set():
+                self._callbacks += [fn]
+                return
+        fn(self)
+
+    def _finish(self, result=None, exc_info=None):
+        with self._lock:
+            self._result = result
+            self._exc_info = exc_info
+            self._done.set()
+            callbacks, self._callbacks = self._callbacks, []
+        for fn in callbacks:
+            fn(self)
+
 def floatify(thing):
     ''' take a pvcmd string 'thing' and turn it into a representitive python object '''
     try:
@@ -293,6 +553,20 @@ class PvApp(object):
         val = pythify(val)
         return val
 
+    def GetParams(self, params):
+        ''' get several parameters at once (see PvCmd._run_pvcmd_batch), as a dict '''
+        results = self.pv._run_pvcmd_batch([('-get', self.app, param) for param in params])
+        vals = {}
+        failed = []
+        for param, (res, err, rc) in zip(params, results):
+            if rc or len(err):
+                failed += [param]
+            else:
+                vals[param] = pythify(res)
+        if failed:
+            raise ValueError("Error from pvcmd getting: %s" % (', '.join(failed)))
+        return vals
+
     def SetParam(self, param, value):
         ''' '''
         self.pv._run_pvcmd('-set', self.app, param, str(value))
@@ -327,8 +601,75 @@ class PvApp(object):
         return self.Command('CmdList')
 
 class PvScan(PvApp):
+    # commands after which we no longer know which object is selected
+    selcmds = ['pvDsetSsel', 'pvDsetClone', 'pvDsetDel', 'pvDsetUndo',
+               'pvDsetCreateStudy', 'pvDsetObjListRemove']
+
     def __init__(self, pv):
         super (PvScan, self).__init__('pvScan', pv)
+        # pv has one selection: whoever selects an object holds this until
+        # they're done with it, PvObj's operations take it around their
+        # SetObj() and what follows.  guards _selected too
+        self.lock = threading.RLock()
+        self._selected = None
+        self._queue = None
+
+    def Submit(self, fn, *args, **kwargs):
+        '''
+        run fn(*args, **kwargs) on the operation queue's thread, after
+        everything submitted before it, and return a PvFuture for the result.
+        queued operations run in order.  other threads can use pv meanwhile,
+        self.lock keeps their selections and commands from interleaving with
+        the queue's, but not from waiting for its current command.
+        '''
+        if not self._queue:
+            self._queue = Queue.Queue()
+            worker = threading.Thread(target=self._worker, name='PvScan.Submit')
+            worker.daemon = True
+            worker.start()
+        future = PvFuture()
+        self._queue.put((future, fn, args, kwargs))
+        return future
+
+    def _worker(self):
+        while True:
+            future, fn, args, kwargs = self._queue.get()
+            try:
+                future._finish(fn(*args, **kwargs))
+            except Exception:
+                self.log.exception('Submit: %s failed' % fn)
+                future._finish(exc_info=sys.exc_info())
+
+    def Command(self, *cmd):
+        with self.lock:
+            if cmd and cmd[0] in self.selcmds:
+                self._selected = None
+            res = super (PvScan, self).Command(*cmd)
+            if cmd[0:3] == ('pvDsetPath', '-path', 'PROCNO'):
+                self._selected = res
+            return res
+
+    # each single pv call takes the lock too, so it can't land in the
+    # middle of another thread's SetObj() sequence
+    def CommandQuiet(self, *cmd):
+        with self.lock:
+            return super (PvScan, self).CommandQuiet(*cmd)
+
+    def GetParam(self, param):
+        with self.lock:
+            return super (PvScan, self).GetParam(param)
+
+    def GetParams(self, params):
+        with self.lock:
+            return super (PvScan, self).GetParams(params)
+
+    def SetParam(self, param, value):
+        with self.lock:
+            return super (PvScan, self).SetParam(param, value)
+
+    def Sync(self, path=None):
+        with self.lock:
+            return super (PvScan, self).Sync(path)
 
 #    def ExpPath(self):
 #        ''' get full current experiment path '''
@@ -349,6 +690,17 @@ class PvScan(PvApp):
     def ProcPath(self):
         return self.Command('pvDsetPath', '-path', 'PROCNO')
 
+    def GetStudyObjs(self, studypath=None):
+        '''
+        the first reco of every scan in the (current) study, found on disk
+        rather than by stepping through the scan list
+        '''
+        if not studypath:
+            studypath = self.StudyPath()
+        expnos = sorted(int(d) for d in os.listdir(studypath)
+                        if is_int(d) and os.path.isdir(studypath + '/' + d + '/pdata/1'))
+        return [PvObj(studypath + '/' + str(expno) + '/pdata/1', self) for expno in expnos]
+
     def Popup(self, message):
         return self.Command('pvErrorAlert', 'Python', message)
         #self.pv._run_pvcmd('-s', 'gui', app, message)
@@ -365,7 +717,14 @@ class PvScan(PvApp):
         self.Command('CprNoWait','setdef','ackn','ok')
 
     def SetObj(self, pvobj):
-        ''' set the currently selected object to pvobj '''
+        '''
+        set the currently selected object to pvobj.  hold self.lock from
+        before this until done with the selection
+        '''
+        with self.lock:
+            self._setobj(pvobj)
+
+    def _setobj(self, pvobj):
         self.log.debug('SetObj(%s)' % pvobj)
         if is_int(pvobj):
             # just change the EXPNO
@@ -381,8 +740,11 @@ class PvScan(PvApp):
                 #self.CommandQuiet('pvDsetSsel', str(pvobj))
             else:
                 raise ValueError('PvCmd::SetObj: invalid (empty) expno:'+str(pvobj))
+        if str(pvobj) == self._selected:
+            return
         #self.CommandQuiet('pvDsetSsel', str(pvobj))
         self.CommandQuiet('pvDsetObjSel', str(pvobj))
+        self._selected = str(pvobj)
 
     # pvDsetSsel New
     # pvDsetSsel New PROTOCOL LOCATION
@@ -398,6 +760,10 @@ class PvScan(PvApp):
     def GetObj(self, index=None, restore=True):
         ''' get the currently selected object, or the object at the numerical 'index' '''
         self.log.info('GetObj(%s,%s)' % (index, restore))
+        with self.lock:
+            return self._getobj(index, restore)
+
+    def _getobj(self, index, restore):
         if index:
             if restore:
                 oldobj = self.ProcPath()
@@ -415,6 +781,10 @@ class PvScan(PvApp):
         ''' return a list of all objecs in the object list '''
         ''' doens't really work '''
         self.log.info('GetObjList')
+        with self.lock:
+            return self._getobjlist()
+
+    def _getobjlist(self):
         pvobjlist = []
         index = 0
         seen = []
@@ -477,8 +847,9 @@ class PvScan(PvApp):
         pvDsetListLocations
         '''
         self.log.info('NewScan')
-        self.Command('pvDsetSsel', 'New', protocolLoc, protocolName)
-        return self.GetObj()
+        with self.lock:
+            self.Command('pvDsetSsel', 'New', protocolLoc, protocolName)
+            return self.GetObj()
 
     # Reset commands
     # pvcmd -a pvScan pvResetInstrument
@@ -495,6 +866,7 @@ class PvCmd(object):
         self._pvcmd = ''
         self._pvapps = dict()
         self.verbose = False
+        self.spawns = 0         # pvcmd processes started
         self.log = logging.getLogger('PvCmd')
 
         # find the pvcmd binary
@@ -520,7 +892,7 @@ class PvCmd(object):
         #print "running apps:", self._pvapps.keys()
 
     def __setattr__(self, name, value):
-        if (name not in ['_pvcmd', '_pvapps', 'XWINNMRHOME', 'verbose', 'log']
+        if (name not in ['_pvcmd', '_pvapps', 'XWINNMRHOME', 'verbose', 'spawns', 'log']
             and not hasattr(self, name)): # would this create a new attribute?
             raise AttributeError("Creating new attribute '%s' is not allowed!" % name)
         super (PvCmd, self).__setattr__(name, value)
@@ -533,6 +905,7 @@ class PvCmd(object):
             cmd = [self._pvcmd]
             cmd += args
             self.log.debug('#%s' % str(cmd))
+            self.spawns += 1
             p = subprocess.Popen(cmd, shell=False,
                                  stdin=subprocess.PIPE,
                                  stdout=subprocess.PIPE,
@@ -555,6 +928,59 @@ class PvCmd(object):
         #print res
         return res.strip()
 
+    def _run_pvcmd_batch(self, calls):
+        '''
+        run several '-get' pvcmd invocations one after another from one
+        shell, instead of a python subprocess each.  returns a list of
+        (output, error, returncode), one per call.
+
+        pvcmd gets one parameter per invocation, so it's still one pvcmd
+        process per call, each counted in self.spawns, and never two pv
+        clients at once.  only '-get's are allowed, a batch doesn't change
+        anything in pv.
+        '''
+        if not calls:
+            return []
+        for args in calls:
+            if not args or args[0] != '-get':
+                raise ValueError('_run_pvcmd_batch: only -get calls, not %s' % str(args))
+        mark = '@@pvcmd-batch@@'
+        script = ''
+        for args in calls:
+            script += '"$0" %s <&-; rc=$?; echo; echo "%s $rc"; echo >&2; echo "%s" >&2\n' % (
+                ' '.join(pipes.quote(str(a)) for a in args), mark, mark)
+        self.log.debug('#batch %s' % str(calls))
+        self.spawns += len(calls)
+        p = subprocess.Popen(['/bin/sh', '-c', script, self._pvcmd], shell=False,
+                             stdin=subprocess.PIPE,
+                             stdout=subprocess.PIPE,
+                             stderr=subprocess.PIPE)
+        out, err = p.communicate(input='')
+        results = []
+        res = []
+        for line in out.splitlines():
+            if line.startswith(mark):
+                results += [['\n'.join(res).strip(), '', int(line.split()[1])]]
+                res = []
+            else:
+                res += [line]
+        errs = []
+        res = []
+        for line in err.splitlines():
+            if line == mark:
+                errs += ['\n'.join(res).strip()]
+                res = []
+            else:
+                res += [line]
+        if len(results) != len(calls) or len(errs) != len(calls):
+            raise ValueError("Error from pvcmd batch: %s" % (err))
+        for result, error in zip(results, errs):
+            result[1] = error
+        if self.verbose:
+            for args, result in zip(calls, results):
+                print 'pvcmd: ', str(args), '/', result[0], '/', result[1], '/', result[2]
+        return [tuple(result) for result in results]
+
     def runningApps(self):
         appnames = self._run_pvcmd('-l').split()
         for name in appnames:
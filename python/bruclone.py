@@ -0,0 +1,162 @@
+#!/usr/bin/env python
+#
+# clone bruker experiment directories without copying what isn't needed
+#
+# (c)2016 Michael Tesch. tesch1@gmail.com
+#
+'''
+clone_experiment() copies an experiment directory (.../name/expno) the way
+CLONEDATASET wants it: the parameter files are copied, processed data
+(pdata/*/1r, 2rr...) is left out, and the raw data (fid, ser...) is handled
+according to 'raw':
+
+'copy'    - copy it
+'reflink' - share the blocks with the original (FICLONE: btrfs, xfs...) so
+            nothing is copied until one of them is written, otherwise copy
+'link'    - reflink, otherwise hardlink, otherwise copy.  a hardlinked fid
+            is the SAME file as the original: only use this if the clone's
+            raw data won't be rewritten in place (ie. by zg).  only the raw
+            data is ever hardlinked
+'skip'    - leave it out, for clones that are going to be acquired anyway
+
+other files of 'large' bytes or more (big 2rr's, job files...) are
+reflinked when possible and otherwise copied, whatever 'raw' is (except
+'copy').  reflink and copy are always safe.  this also runs under topspin's jython,
+where there is no fcntl and 'reflink' just copies.
+
+python bruclone.py [-m mode] [-p] [-b] olddir newdir
+    -b compares the modes (and the old copytree-then-delete), cloning into
+       scratch directories next to newdir
+'''
+import os
+import sys
+import time
+import errno
+import shutil
+import fnmatch
+
+try:
+    import fcntl
+except ImportError:
+    fcntl = None
+
+FICLONE = 0x40049409                        # _IOW(0x94, 9, int), linux
+RAW_FILES = ['fid', 'ser', 'rawdata.job*']  # treated as raw data
+PROCESSED_FILES = ['[1-9]*']                # in pdata/N, not cloned
+LARGE = 1 << 20                             # anything this big is reflinked like raw data
+MODES = ['copy', 'reflink', 'link', 'skip']
+
+def _matches(name, patterns):
+    for pattern in patterns:
+        if fnmatch.fnmatch(name, pattern):
+            return True
+    return False
+
+def reflink(src, dst):
+    ''' make dst share src's data blocks, False if the filesystem can't '''
+    if fcntl is None or not hasattr(fcntl, 'ioctl') or not sys.platform.startswith('linux'):
+        return False
+    sfd = os.open(src, os.O_RDONLY)
+    try:
+        dfd = os.open(dst, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o644)
+        try:
+            fcntl.ioctl(dfd, FICLONE, sfd)
+            ok = True
+        except (IOError, OSError):
+            ok = False
+        os.close(dfd)
+    finally:
+        os.close(sfd)
+    if not ok:
+        os.remove(dst)
+        return False
+    shutil.copystat(src, dst)
+    return True
+
+def hardlink(src, dst):
+    ''' hardlink dst to src, False if not possible (other filesystem...) '''
+    if not hasattr(os, 'link'):
+        return False
+    try:
+        os.link(src, dst)
+    except OSError as ex:
+        if ex.errno in (errno.EXDEV, errno.EPERM, errno.EMLINK, errno.ENOTSUP):
+            return False
+        raise
+    return True
+
+def clone_experiment(olddir, newdir, raw='reflink', pdata=False, large=LARGE):
+    '''
+    clone the experiment 'olddir' into the new directory 'newdir', copying
+    processed data only if 'pdata'.  returns counts of what was done:
+    {'copied', 'reflinked', 'linked', 'skipped', 'bytes_copied'}
+    '''
+    if raw not in MODES:
+        raise ValueError('clone_experiment: raw must be one of ' + ', '.join(MODES))
+    if os.path.exists(newdir):
+        raise OSError(errno.EEXIST, 'clone_experiment: already exists', newdir)
+    stats = dict(copied=0, reflinked=0, linked=0, skipped=0, bytes_copied=0)
+    olddir = os.path.normpath(olddir)
+    for dirpath, dirnames, filenames in os.walk(olddir):
+        rel = os.path.relpath(dirpath, olddir)
+        target = os.path.normpath(os.path.join(newdir, rel))
+        os.makedirs(target)
+        # processed data lives in pdata/<procno>
+        parts = rel.split(os.sep)
+        inprocno = len(parts) == 2 and parts[0] == 'pdata'
+        for name in sorted(filenames):
+            src = os.path.join(dirpath, name)
+            dst = os.path.join(target, name)
+            if inprocno and not pdata and _matches(name, PROCESSED_FILES):
+                stats['skipped'] += 1
+                continue
+            size = os.path.getsize(src)
+            israw = _matches(name, RAW_FILES) and rel == '.'
+            if israw and raw == 'skip':
+                stats['skipped'] += 1
+                continue
+            if israw or size >= large:
+                if raw != 'copy' and reflink(src, dst):
+                    stats['reflinked'] += 1
+                    continue
+                # a hardlinked 1r or acqp would be rewritten with the clone's
+                if raw == 'link' and israw and hardlink(src, dst):
+                    stats['linked'] += 1
+                    continue
+            shutil.copy2(src, dst)
+            stats['copied'] += 1
+            stats['bytes_copied'] += size
+        shutil.copystat(dirpath, target)
+    return stats
+
+def _bench(olddir, newdir, pdata):
+    ''' time each mode, and the old copytree-then-delete, cloning olddir '''
+    def old(src, dst):
+        shutil.copytree(src, dst)
+        for name in os.listdir(os.path.join(dst, 'pdata', '1')):
+            if _matches(name, PROCESSED_FILES):
+                os.remove(os.path.join(dst, 'pdata', '1', name))
+        return {}
+    runs = [('copytree', old)]
+    for mode in MODES:
+        runs += [(mode, lambda src, dst, mode=mode: clone_experiment(src, dst, mode, pdata))]
+    for name, fn in runs:
+        scratch = '%s.bench-%s' % (newdir, name)
+        start = time.time()
+        stats = fn(olddir, scratch)
+        elapsed = time.time() - start
+        shutil.rmtree(scratch)
+        print('%-9s %8.3f s  %s' % (name, elapsed,
+              ' '.join('%s=%s' % kv for kv in sorted(stats.items()))))
+
+if __name__ == '__main__':
+    import getopt
+    opts, args = getopt.getopt(sys.argv[1:], 'm:pb')
+    opts = dict(opts)
+    if len(args) != 2:
+        print(__doc__)
+        sys.exit(1)
+    if '-b' in opts:
+        _bench(args[0], args[1], '-p' in opts)
+    else:
+        print(clone_experiment(args[0], args[1], opts.get('-m', 'reflink'), '-p' in opts))
@@ -0,0 +1,290 @@
+#!/usr/bin/env python
+#
+# readers for bruker data files, returning numpy arrays mapped from disk
+#
+# (c)2016 Michael Tesch. tesch1@gmail.com
+#
+# the parameters are parsed by the jcampdx module, the data itself is
+# np.memmap'ed, never read up front.  when the bytes on disk are already
+# the array we want (native byte order, no scaling) the result is a
+# zero-copy view.  otherwise it's a LazyArray, which converts only the rows
+# that are indexed, so opening a 10GB ser costs nothing.
+#
+import os
+import numpy as np
+
+import jcampdx
+
+class LazyArray(object):
+    ''' an array converted from disk a few rows (along axis 0) at a time
+
+    indexing converts just the rows needed, np.asarray() converts it all.
+    '''
+    chunk_bytes = 64 << 20
+
+    def __init__(self, shape, dtype, rows):
+        ''' rows(start, stop) must return the converted rows [start, stop) '''
+        self.shape = tuple(int(n) for n in shape)
+        self.dtype = np.dtype(dtype)
+        self._rows = rows
+
+    @property
+    def ndim(self):
+        return len(self.shape)
+
+    @property
+    def size(self):
+        return int(np.prod(self.shape))
+
+    def __len__(self):
+        return self.shape[0]
+
+    def __repr__(self):
+        return 'LazyArray(shape={0}, dtype={1})'.format(self.shape, self.dtype)
+
+    def chunks(self, nrows=None):
+        ''' iterate over (start, rows) covering the whole array '''
+        if nrows is None:
+            rowbytes = max(self.dtype.itemsize * self.size // max(self.shape[0], 1), 1)
+            nrows = max(self.chunk_bytes // rowbytes, 1)
+        for start in range(0, self.shape[0], nrows):
+            yield start, self._rows(start, min(start + nrows, self.shape[0]))
+
+    def __iter__(self):
+        for start, rows in self.chunks():
+            for row in rows:
+                yield row
+
+    def __getitem__(self, key):
+        if not isinstance(key, tuple):
+            key = (key,)
+        first, rest = key[0], key[1:]
+        if first is Ellipsis:
+            return np.asarray(self)[key]
+        idx = np.arange(self.shape[0])[first]
+        if idx.ndim == 0:
+            out = self._rows(int(idx), int(idx) + 1)[0]
+            return out[rest] if rest else out
+        if idx.size == 0:
+            out = np.empty((0,) + self.shape[1:], self.dtype)
+        else:
+            lo, hi = int(idx.min()), int(idx.max()) + 1
+            out = self._rows(lo, hi)[idx - lo]
+        return out[(slice(None),) + rest] if rest else out
+
+    def __array__(self, dtype=None, copy=None):
+        out = np.empty(self.shape, self.dtype)
+        for start, rows in self.chunks():
+            out[start:start + len(rows)] = rows
+        return out.astype(dtype, copy=False) if dtype is not None else out
+
+def _native(dt):
+    return dt.isnative or dt.itemsize == 1
+
+def _mapped(filename, dtype, shape, offset=0, strides=None):
+    ''' read-only ndarray view of 'filename', no copying '''
+    dtype = np.dtype(dtype)
+    if not int(np.prod(shape)):
+        return np.empty(shape, dtype)
+    mm = np.memmap(filename, dtype=np.uint8, mode='r')
+    return np.ndarray(shape, dtype, buffer=mm, offset=offset, strides=strides)
+
+def _getnum(ldrs, label, default):
+    return ldrs.getDouble(label) if ldrs.labelExists(label) else default
+
+class RawData(object):
+    ''' fid or ser of an experiment, like matlab/rawdata.hpp
+
+    raw  - (rows, TD/2, 2) view of the file, on-disk type & byte order
+    fid  - (rows, points) complex128, the group delay removed according to
+           'grpdly': 'none', 'shift' (rotated to the end of each fid) or
+           'truncate' (dropped)
+    '''
+    def __init__(self, exppath, grpdly='none', acqus=None):
+        self.acqus = acqus or jcampdx.Ldrset(os.path.join(exppath, 'acqus'))
+        self.datafile = os.path.join(exppath, 'ser')
+        if not os.path.exists(self.datafile):
+            self.datafile = os.path.join(exppath, 'fid')
+        isser = self.datafile.endswith('ser')
+
+        dtypa = int(_getnum(self.acqus, 'DTYPA', 0))
+        if dtypa not in (0, 2):
+            raise ValueError('{0}: unsupported DTYPA={1}'.format(self.datafile, dtypa))
+        dt = np.dtype('i4' if dtypa == 0 else 'f8')
+        dt = dt.newbyteorder('>' if int(_getnum(self.acqus, 'BYTORDA', 0)) else '<')
+        td = int(self.acqus.getDouble('TD')) // 2
+
+        # each fid in a ser starts on a 1024 byte boundary
+        nbytes = td * 2 * dt.itemsize
+        rowbytes = (nbytes + 1023) & ~1023
+        filesize = os.path.getsize(self.datafile)
+        if isser and filesize % rowbytes and not filesize % nbytes:
+            rowbytes = nbytes
+        rows = filesize // rowbytes + (filesize % rowbytes >= nbytes)
+        if not isser:
+            rows = min(rows, 1)
+
+        self.raw = _mapped(self.datafile, dt, (rows, td, 2),
+                           strides=(rowbytes, 2 * dt.itemsize, dt.itemsize))
+
+        if grpdly not in ('none', 'shift', 'truncate'):
+            raise ValueError("grpdly must be 'none', 'shift' or 'truncate'")
+        self.group_delay = 0.0 if grpdly == 'none' else jcampdx.bru_group_delay(self.acqus)
+        if grpdly == 'shift':
+            self._skip = min(int(np.floor(self.group_delay)), td)
+        else:
+            self._skip = min(int(np.floor(self.group_delay + 0.5)), td)
+        self._mode = grpdly
+        self.residual_delay = self.group_delay - self._skip
+        points = td - self._skip if grpdly == 'truncate' else td
+        self.fid = LazyArray((rows, points), np.complex128, self._convert)
+
+    def _convert(self, start, stop):
+        raw = self.raw[start:stop]
+        out = np.empty(raw.shape[:2], np.complex128)
+        out.real = raw[:, :, 0]
+        out.imag = raw[:, :, 1]
+        if self._mode == 'shift':
+            out = np.roll(out, -self._skip, axis=1)
+        elif self._mode == 'truncate':
+            out = out[:, self._skip:]
+        return out
+
+class ProcData(object):
+    ''' TopSpin processed data (1r, 2rr, 3rrr...), like matlab/procdata.hpp
+
+    data(name) is shaped (SI of procNs, ..., SI of procs), the direct
+    dimension last.  XDIM submatrices are undone with a strided view.
+    '''
+    procfiles = ['procs', 'proc2s', 'proc3s']
+
+    def __init__(self, procpath):
+        self.procpath = procpath
+        self.procs = []
+        for name in self.procfiles:
+            filename = os.path.join(procpath, name)
+            if not os.path.exists(filename):
+                break
+            self.procs.append(jcampdx.Ldrset(filename))
+        if not self.procs:
+            raise ValueError('no procs in ' + procpath)
+        procs = self.procs[0]
+        dtypp = int(_getnum(procs, 'DTYPP', 0))
+        if dtypp not in (0, 2):
+            raise ValueError('{0}: unsupported DTYPP={1}'.format(procpath, dtypp))
+        dt = np.dtype('i4' if dtypp == 0 else 'f8')
+        self.dtype = dt.newbyteorder('>' if int(_getnum(procs, 'BYTORDP', 0)) else '<')
+        self.scale = 2.0 ** _getnum(procs, 'NC_proc', 0) if dtypp == 0 else 1.0
+
+    def data(self, name):
+        ''' the processed data file 'name', ie '1r' or '2ii' '''
+        ndim = int(name[0])
+        if ndim > len(self.procs):
+            raise ValueError('{0}: {1} needs {2} procNs files'.format(self.procpath, name, ndim))
+        si = [int(p.getDouble('SI')) for p in self.procs[:ndim]]
+        xdim = [int(_getnum(p, 'XDIM', s)) or s for p, s in zip(self.procs, si)]
+        xdim = [x if x <= s else s for x, s in zip(xdim, si)]
+        for s, x in zip(si, xdim):
+            if not s or s % x:
+                raise ValueError('{0}: SI={1} not a multiple of XDIM={2}'.format(self.procpath, s, x))
+        ntiles = [s // x for s, x in zip(si, xdim)]
+
+        # file order is tile, then point within the tile, dim 0 fastest:
+        # view it as (nt[n-1], x[n-1], ..., nt[0], x[0]) without copying
+        itemsize = self.dtype.itemsize
+        tilebytes = itemsize * int(np.prod(xdim))
+        shape, strides = [], []
+        tstride = tilebytes
+        xstride = itemsize
+        for dim in range(ndim):
+            shape[:0] = [ntiles[dim], xdim[dim]]
+            strides[:0] = [tstride, xstride]
+            tstride *= ntiles[dim]
+            xstride *= xdim[dim]
+        view = _mapped(os.path.join(self.procpath, name), self.dtype, tuple(shape),
+                       strides=tuple(strides))
+        outshape = tuple(reversed(si))
+
+        if ndim == 1 or xdim == si:
+            flat = view.reshape(outshape)
+            if _native(self.dtype) and self.scale == 1:
+                return flat
+            return LazyArray(outshape, np.float64, lambda a, b: flat[a:b] * self.scale)
+
+        def rows(start, stop):
+            # rows of the slowest dimension: (tile, point in tile)
+            x = xdim[-1]
+            out = np.empty((stop - start,) + outshape[1:], np.float64)
+            for rr in range(start, stop):
+                out[rr - start] = view[rr // x, rr % x].reshape(outshape[1:])
+            return out * self.scale if self.scale != 1 else out
+        return LazyArray(outshape, np.float64, rows)
+
+class VisuData(object):
+    ''' ParaVision 2dseq, described by visu_pars, like matlab/visudata.hpp
+
+    data() is shaped (frame groups reversed..., core size reversed...),
+    ie (slices, y, x), with VisuCoreDataSlope/Offs applied per frame.
+    '''
+    wordtypes = {
+        '_32BIT_SGN_INT':  'i4',
+        '_16BIT_SGN_INT':  'i2',
+        '_8BIT_UNSGN_INT': 'u1',
+        '_32BIT_FLOAT':    'f4',
+        }
+
+    def __init__(self, procpath, visu_pars=None):
+        self.visu_pars = visu_pars or jcampdx.Ldrset(os.path.join(procpath, 'visu_pars'))
+        self.seqfile = os.path.join(procpath, '2dseq')
+        vp = self.visu_pars.to_dict()
+        wordtype = vp['VisuCoreWordType']
+        if wordtype not in self.wordtypes:
+            raise ValueError("unknown VisuCoreWordType: '{0}'".format(wordtype))
+        dt = np.dtype(self.wordtypes[wordtype])
+        self.dtype = dt.newbyteorder('>' if vp.get('VisuCoreByteOrder') == 'bigEndian' else '<')
+
+        self.coresize = [int(n) for n in np.atleast_1d(vp['VisuCoreSize'])]
+        self.framecount = int(vp.get('VisuCoreFrameCount', 1))
+        # frame groups: (len, <id>, <comment>, valsStart, valsCnt)
+        fglen = [int(fg[0]) for fg in vp.get('VisuFGOrderDesc') or [] if isinstance(fg, list)]
+        if int(np.prod(fglen)) != self.framecount:
+            fglen = [self.framecount]
+        self.shape = tuple(reversed(self.coresize + fglen))
+
+        def perframe(label, default):
+            vals = np.atleast_1d(np.asarray(vp.get(label, default), np.float64))
+            return np.resize(vals, self.framecount)
+        self.slope = perframe('VisuCoreDataSlope', 1.0)
+        self.offset = perframe('VisuCoreDataOffs', 0.0)
+
+    def data(self, dtype=np.float32):
+        ''' the image, as 'dtype' after scaling '''
+        framesize = int(np.prod(self.coresize))
+        raw = _mapped(self.seqfile, self.dtype, (self.framecount, framesize))
+        if (_native(self.dtype) and self.dtype == np.dtype(dtype)
+            and (self.slope == 1).all() and (self.offset == 0).all()):
+            return raw.reshape(self.shape)
+        # a row is some frames, or without frame groups part of the one frame
+        rowsize = self.framecount * framesize // self.shape[0]
+        def rows(start, stop):
+            # scale the whole frames the rows are in, then keep just the rows
+            e0, e1 = start * rowsize, stop * rowsize
+            f0, f1 = e0 // framesize, -(-e1 // framesize)
+            out = raw[f0:f1].astype(dtype)
+            out *= self.slope[f0:f1, None].astype(dtype)
+            out += self.offset[f0:f1, None].astype(dtype)
+            out = out.reshape(-1)[e0 - f0 * framesize:e1 - f0 * framesize]
+            return out.reshape((stop - start,) + self.shape[1:])
+        return LazyArray(self.shape, dtype, rows)
+
+def read_fid(exppath, grpdly='none'):
+    ''' the fid or ser in 'exppath' as a lazily converted complex array '''
+    return RawData(exppath, grpdly).fid
+
+def read_pdata(procpath, name='1r'):
+    ''' processed data 'name' in 'procpath' (ie ../expno/pdata/1) '''
+    return ProcData(procpath).data(name)
+
+def read_2dseq(procpath, dtype=np.float32):
+    ''' the 2dseq image in 'procpath' '''
+    return VisuData(procpath).data(dtype)
@@ -4,11 +4,228 @@
 %include "std_set.i"
 %include "std_vector.i"
 %include "std_string.i"
+%include "stdint.i"
 %apply const std::string& {std::string* foo};
+%template(DoubleVector) std::vector<double>;
 
 %{
 #define SWIG_FILE_WITH_INIT
 #include "jcampdx.hpp"
+#include "brulist.hpp"
+#include "ldrbatch.hpp"
+#include "pyldr.hpp"
+#include "rawdata.hpp"
+#include "counters.hpp"
+
+std::atomic<DebugLevel> g_debug_level(LEVEL_WARN);
+void DebugFunc(DebugLevel level, const char * str, const char * location)
+{
+  // may be called without the GIL, from a loader thread
+  std::cerr << location << ":" << str << "\n";
+}
+%}
+
+%init %{
+#if PY_VERSION_HEX < 0x03070000
+  PyEval_InitThreads();
+#endif
+  pyldr_init();
 %}
 
+// parse without holding the GIL, so python threads can load files in parallel
+%define JCAMP_NOGIL(function)
+%exception function {
+  bool _failed = false;
+  std::string _errmsg;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    $action
+  }
+  catch (const std::exception & ex) {
+    _failed = true;
+    _errmsg = ex.what();
+  }
+  Py_END_ALLOW_THREADS
+  if (_failed) {
+    PyErr_SetString(PyExc_IOError, _errmsg.c_str());
+    SWIG_fail;
+  }
+}
+%enddef
+
+JCAMP_NOGIL(Ldrset::Ldrset)
+JCAMP_NOGIL(Ldrset::loadFile)
+JCAMP_NOGIL(Ldrset::loadString)
+JCAMP_NOGIL(BruList::BruList)
+JCAMP_NOGIL(BruList::loadFile)
+JCAMP_NOGIL(BruList::loadString)
+
+// load_many(shared=True) is how python shares ldrs & strings between files
+%ignore LdrPool;
+%ignore LdrDict;
+%ignore Ldrset::setPool;
+%ignore Ldrset::setDict;
+%ignore Ldrset::dict;
+%ignore Ldrset::shareLdr;
+// python gets the const getLdr(): the other copies a pooled ldr, and can
+// free the one an earlier const getLdr() returned
+%ignore Ldrset::getLdr(const string & label);
 %include "jcampdx.hpp"
+%include "brulist.hpp"
+
+%extend Ldr {
+  %template(num) num<double>;
+}
+%extend Ldrset {
+  %template(getNum) getNum<double>;
+}
+
+// used by brudata.py to undo the digital filter delay
+double bru_group_delay(const Ldrset & acqus);
+
+%pythoncode %{
+try:
+    import numpy
+except ImportError:
+    numpy = None
+%}
+
+%{
+static Ldrset * _as_ldrset(PyObject * obj)
+{
+  Ldrset * ptr = 0;
+  if (!SWIG_IsOK(SWIG_ConvertPtr(obj, (void **)&ptr, SWIGTYPE_p_Ldrset, 0)) || !ptr) {
+    PyErr_SetString(PyExc_TypeError, "expected an Ldrset");
+    return NULL;
+  }
+  return ptr;
+}
+%}
+
+%inline %{
+PyObject * _ldr_buffer(PyObject * ldrset, const std::string & label)
+{
+  Ldrset * ptr = _as_ldrset(ldrset);
+  return ptr ? pyldr_buffer(*ptr, label) : NULL;
+}
+
+PyObject * _ldrset_dict(PyObject * ldrset)
+{
+  Ldrset * ptr = _as_ldrset(ldrset);
+  return ptr ? pyldr_dict(*ptr) : NULL;
+}
+
+PyObject * _load_many(PyObject * paths, int threads, bool as_dict, size_t float_tables, bool shared)
+{
+  std::vector<std::string> filenames;
+  if (!pyldr_strings(paths, filenames))
+    return NULL;
+
+  std::vector<LdrLoadResult> loaded;
+  Py_BEGIN_ALLOW_THREADS
+  loaded = ldr_load_many(filenames, threads > 0 ? threads : 0,
+                         NumPolicy(float_tables > 0, float_tables),
+                         shared ? std::make_shared<LdrPool>() : std::shared_ptr<LdrPool>(),
+                         shared ? std::make_shared<LdrDict>() : std::shared_ptr<LdrDict>());
+  Py_END_ALLOW_THREADS
+
+  PyObject * results = PyList_New((Py_ssize_t)loaded.size());
+  PyObject * errors = PyList_New((Py_ssize_t)loaded.size());
+  if (!results || !errors) {
+    Py_XDECREF(results);
+    Py_XDECREF(errors);
+    return NULL;
+  }
+  for (size_t ii = 0; ii < loaded.size(); ii++) {
+    PyObject * res = Py_None;
+    PyObject * err = Py_None;
+    Py_INCREF(Py_None);
+    Py_INCREF(Py_None);
+    if (loaded[ii].ldrset) {
+      Ldrset * ldrs = loaded[ii].ldrset.release();
+      PyObject * obj = SWIG_NewPointerObj(SWIG_as_voidptr(ldrs), SWIGTYPE_p_Ldrset, SWIG_POINTER_OWN);
+      if (obj && as_dict) {
+        PyObject * dict = pyldr_dict(*ldrs);
+        Py_DECREF(obj);
+        obj = dict;
+      }
+      if (obj) {
+        Py_DECREF(res);
+        res = obj;
+      }
+      else {
+        Py_DECREF(err);
+        err = PYLDR_STRING("conversion failed", 17);
+        PyErr_Clear();
+      }
+    }
+    else {
+      Py_DECREF(err);
+      err = PYLDR_STRING(loaded[ii].error.c_str(), (Py_ssize_t)loaded[ii].error.size());
+    }
+    PyList_SET_ITEM(results, (Py_ssize_t)ii, res);
+    PyList_SET_ITEM(errors, (Py_ssize_t)ii, err);
+  }
+  PyObject * ret = PyTuple_Pack(2, results, errors);
+  Py_DECREF(results);
+  Py_DECREF(errors);
+  return ret;
+}
+%}
+
+%inline %{
+//! the event counters (see counters.hpp) as {name: count}
+PyObject * counters()
+{
+  PyObject * dict = PyDict_New();
+  if (!dict)
+    return NULL;
+  for (auto & counter : Counter::snapshot()) {
+    PyObject * val = PyLong_FromUnsignedLongLong(counter.second);
+    if (!val || PyDict_SetItemString(dict, counter.first.c_str(), val)) {
+      Py_XDECREF(val);
+      Py_DECREF(dict);
+      return NULL;
+    }
+    Py_DECREF(val);
+  }
+  return dict;
+}
+
+void reset_counters()
+{
+  Counter::resetAll();
+}
+%}
+
+%pythoncode %{
+def load_many(paths, threads=0, as_dict=False, float_tables=0, shared=False):
+    """parse every file in 'paths' on 'threads' C++ threads (0 = all cores)
+
+    returns (results, errors): results[i] is an Ldrset (or a dict if
+    'as_dict'), or None if paths[i] failed, and errors[i] says why.
+    numeric arrays of 'float_tables' or more values are kept as float32.
+    with 'shared', parameters equal across the files are stored once, and
+    short strings are coded: ldrs.getLdr(label).code() == ldrs.findCode('Yes')
+    compares without a string compare, codes group the files by a value.
+    """
+    return _load_many(list(paths), threads, as_dict, float_tables, shared)
+%}
+
+%extend Ldrset {
+%pythoncode %{
+    def array(self, label):
+        """read-only numpy view (or memoryview) of the numbers in 'label', no copy"""
+        buf = _ldr_buffer(self, label)
+        return numpy.asarray(buf) if numpy is not None else memoryview(buf)
+
+    def to_dict(self):
+        """all the ldrs as {label: value}, numeric arrays as read-only views"""
+        dd = _ldrset_dict(self)
+        if numpy is not None:
+            for key, val in dd.items():
+                if isinstance(val, memoryview):
+                    dd[key] = numpy.asarray(val)
+        return dd
+%}
+}
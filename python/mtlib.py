@@ -12,6 +12,8 @@ import shutil
 import glob
 import datetime
 
+import bruclone
+
 from TopCmds import *
 
 # bruker-provided stuff
@@ -46,8 +48,12 @@ def xPROCPATH(dataset=None):
 def QCMD(cmd):
     return XCMD('qu ' + cmd)
 
-def CLONEDATASET(newexpname, newexpnum, olddataset = None, replace = False, loadIt = True):
-    ''' clone an existing dataset into a new one, delete processed data '''
+def CLONEDATASET(newexpname, newexpnum, olddataset = None, replace = False, loadIt = True,
+                 raw = 'reflink'):
+    ''' clone an existing dataset into a new one, without the processed data
+
+    'raw' says what to do with the fid/ser, see bruclone.clone_experiment()
+    '''
     if not olddataset:
         olddataset = CURDATA()
     newdataset = olddataset[:]
@@ -63,10 +69,7 @@ def CLONEDATASET(newexpname, newexpnum, olddataset = None, replace = False, load
             if loadIt:
                 RE(newdataset)
             return newdataset
-    shutil.copytree(oldpath, newpath)
-    # remove processed data files
-    for datafile in glob.glob(newpath + '/pdata/1/[1-9]*'):
-        os.remove(datafile)
+    bruclone.clone_experiment(oldpath, newpath, raw)
     # load the new dataset into the active "thread"
     if loadIt:
         RE(newdataset)
@@ -35,20 +35,27 @@ class pvshell(cmd.Cmd):
 
     def do_system(self, line):
         ''' print info about the current system '''
-        print "Institution:   ", self.pv.pvScan.GetParam('ACQ_institution')
-        print "System:        ", self.pv.pvScan.GetParam('ACQ_station')
-        print "PV version:    ", self.pv.pvScan.GetParam('ACQ_sw_version')
-        print "Status:        ", self.pv.pvScan.GetParam('ACQ_status')
-        print "Config Status: ", self.pv.pvScan.GetParam('CONFIG_status_string')
-        print "Shim Status:   ", self.pv.pvScan.GetParam('CONFIG_shim_status')
-        print "Instrument:    ", self.pv.pvScan.GetParam('CONFIG_instrument_type')
-        print "Max gradient:  ", self.pv.pvScan.GetParam('PVM_GradCalConst'), "Hz/mm"
+        p = self.pv.pvScan.GetParams(['ACQ_institution', 'ACQ_station', 'ACQ_sw_version',
+                                      'ACQ_status', 'CONFIG_status_string', 'CONFIG_shim_status',
+                                      'CONFIG_instrument_type', 'PVM_GradCalConst'])
+        print "Institution:   ", p['ACQ_institution']
+        print "System:        ", p['ACQ_station']
+        print "PV version:    ", p['ACQ_sw_version']
+        print "Status:        ", p['ACQ_status']
+        print "Config Status: ", p['CONFIG_status_string']
+        print "Shim Status:   ", p['CONFIG_shim_status']
+        print "Instrument:    ", p['CONFIG_instrument_type']
+        print "Max gradient:  ", p['PVM_GradCalConst'], "Hz/mm"
 
     def do_ls(self, line):
-        ''' list available scans ? or something '''
-        objs = self.pv.pvScan.GetObjList()
-        for iobj in objs:
-            print " ".join(str(x) for x in iobj)
+        ''' list the scans in the current study '''
+        for obj in self.pv.pvScan.GetStudyObjs():
+            disk = obj.DiskParams()
+            if disk:
+                print obj.ExpPath().split('/')[-1], disk.get('Method', ''), \
+                    disk.get('ACQ_scan_name', ''), disk.get('PVM_ScanTimeStr', '')
+            else:
+                print obj.ExpPath().split('/')[-1], '(not acquired)'
 
     def do_man(self, line):
         ''' get info about available commands '''
@@ -61,14 +68,16 @@ class pvshell(cmd.Cmd):
     def do_info(self, line):
         ''' print some info about the current scan '''
         obj = self.pv.pvScan.GetObj()
-        print "Scan Method:   ", obj.Method
-        print "Scan Name:     ", obj.ACQ_scan_name
-        print "Scan Completed:", obj.ACQ_completed
-        print "Scan Duration: ", obj.PVM_ScanTimeStr
-        print "Reco Image:    ", obj.RECO_image_type
-        print "BF1:           ", obj.BF1
-        print "RG:            ", obj.RG
-        refAtt = obj.PVM_RefAttCh1
+        p = obj.GetParams(['Method', 'ACQ_scan_name', 'ACQ_completed', 'PVM_ScanTimeStr',
+                           'RECO_image_type', 'BF1', 'RG', 'PVM_RefAttCh1'])
+        print "Scan Method:   ", p['Method']
+        print "Scan Name:     ", p['ACQ_scan_name']
+        print "Scan Completed:", p['ACQ_completed']
+        print "Scan Duration: ", p['PVM_ScanTimeStr']
+        print "Reco Image:    ", p['RECO_image_type']
+        print "BF1:           ", p['BF1']
+        print "RG:            ", p['RG']
+        refAtt = p['PVM_RefAttCh1']
         sp = Spectrometer()
         sp.SetCalibration(1000, refAtt)
         print "RefAtt         ", sp._cal_dBW, ', Hz/V=',sp._cal_Hz_per_V
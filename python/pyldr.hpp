@@ -0,0 +1,252 @@
+// -*-  Mode: C++; c-basic-offset: 2 -*-
+//
+// zero-copy buffer views and dict conversion of Ldrsets for python
+//
+// (c)2016 Michael Tesch, tesch1@gmail.com
+//
+// pyldr_buffer() returns an object exporting the buffer protocol over an
+// Ldr's contiguous numeric storage.  numpy.asarray() or memoryview() of it
+// is a read-only view, no copy, shaped like the declared dimensions.  the
+// view holds the Ldr itself (Ldrset::shareLdr()), so the numbers stay put
+// whatever happens to the Ldrset later: a change to the set, or a reload,
+// changes its own copy.
+//
+#ifndef PYLDR_HPP
+#define PYLDR_HPP
+
+#include <Python.h>
+#include <cstring>
+#include <new>
+#include "jcampdx.hpp"
+
+#if PY_MAJOR_VERSION >= 3
+#define PYLDR_STRING(s, n) PyUnicode_DecodeLatin1(s, n, "replace")
+#else
+#define PYLDR_STRING(s, n) PyString_FromStringAndSize(s, n)
+#endif
+
+enum { PYLDR_MAXDIMS = 16 };
+
+struct PyLdrView {
+  PyObject_HEAD
+  std::shared_ptr<const Ldr> holder;  //!< keeps 'ldr' (it or a group in it) alive
+  const Ldr * ldr;
+  int ndim;
+  Py_ssize_t shape[PYLDR_MAXDIMS];
+  Py_ssize_t strides[PYLDR_MAXDIMS];
+};
+
+static PyTypeObject PyLdrView_Type;
+static PyBufferProcs PyLdrView_Buffer;
+
+static inline void
+pyldrview_dealloc(PyObject * self)
+{
+  ((PyLdrView *)self)->holder.~shared_ptr();
+  PyObject_Del(self);
+}
+
+static inline int
+pyldrview_getbuffer(PyObject * self, Py_buffer * view, int flags)
+{
+  PyLdrView * lv = (PyLdrView *)self;
+  if (flags & PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "Ldr views are read-only");
+    return -1;
+  }
+  // float tables (see NumPolicy) are exported as they're stored
+  bool floats = lv->ldr->floatStorage();
+  size_t itemsize = floats ? sizeof(float) : sizeof(double);
+  view->buf = floats ? (void *)lv->ldr->nums<float>() : (void *)lv->ldr->nums<double>();
+  view->obj = self;
+  Py_INCREF(self);
+  view->len = (Py_ssize_t)(lv->ldr->size() * itemsize);
+  view->readonly = 1;
+  view->itemsize = (Py_ssize_t)itemsize;
+  view->format = (flags & PyBUF_FORMAT) ? (char *)(floats ? "f" : "d") : NULL;
+  view->ndim = lv->ndim;
+  view->shape = (flags & PyBUF_ND) ? lv->shape : NULL;
+  view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? lv->strides : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+static inline void
+pyldr_init()
+{
+  PyLdrView_Buffer.bf_getbuffer = pyldrview_getbuffer;
+  PyTypeObject tmp = { PyVarObject_HEAD_INIT(NULL, 0) };
+  PyLdrView_Type = tmp;
+  PyLdrView_Type.tp_name = "jcampdx.LdrView";
+  PyLdrView_Type.tp_basicsize = sizeof(PyLdrView);
+  PyLdrView_Type.tp_dealloc = pyldrview_dealloc;
+  PyLdrView_Type.tp_as_buffer = &PyLdrView_Buffer;
+#if PY_MAJOR_VERSION >= 3
+  PyLdrView_Type.tp_flags = Py_TPFLAGS_DEFAULT;
+#else
+  PyLdrView_Type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+  PyLdrView_Type.tp_doc = "read-only buffer over the numbers in an Ldr";
+  PyType_Ready(&PyLdrView_Type);
+}
+
+//! a buffer over 'ldr', which is 'holder' or a group inside it
+static inline PyObject *
+pyldr_view(const std::shared_ptr<const Ldr> & holder, const Ldr & ldr)
+{
+  if (!ldr.isNumeric()) {
+    PyErr_Format(PyExc_TypeError, "'%s' is not numeric", ldr.label().c_str());
+    return NULL;
+  }
+  std::vector<int> dims = ldr.dims();
+  if (dims.size() > PYLDR_MAXDIMS) {
+    PyErr_Format(PyExc_ValueError, "'%s' has too many dimensions", ldr.label().c_str());
+    return NULL;
+  }
+  PyLdrView * lv = PyObject_New(PyLdrView, &PyLdrView_Type);
+  if (!lv)
+    return NULL;
+  new (&lv->holder) std::shared_ptr<const Ldr>(holder);
+  lv->ldr = &ldr;
+  lv->ndim = (int)dims.size();
+  Py_ssize_t stride = ldr.floatStorage() ? sizeof(float) : sizeof(double);
+  for (int dd = lv->ndim - 1; dd >= 0; dd--) {
+    lv->shape[dd] = dims[dd];
+    lv->strides[dd] = stride;
+    stride *= dims[dd];
+  }
+  return (PyObject *)lv;
+}
+
+static inline PyObject *
+pyldr_buffer(const Ldrset & ldrs, const string & label)
+{
+  try {
+    std::shared_ptr<const Ldr> ldr = ldrs.shareLdr(label);
+    return pyldr_view(ldr, *ldr);
+  }
+  catch (const std::exception & ex) {
+    PyErr_SetString(PyExc_KeyError, ex.what());
+    return NULL;
+  }
+}
+
+static inline PyObject * pyldr_value(const std::shared_ptr<const Ldr> & holder, const Ldr & ldr);
+
+static inline PyObject *
+pyldr_record(const std::shared_ptr<const Ldr> & holder, const Ldr & ldr, size_t idx)
+{
+  switch (ldr.type(idx)) {
+  case RECORD_NUMERIC:
+    return PyFloat_FromDouble(ldr.num(idx));
+  case RECORD_TEXT:
+  case RECORD_STRING:
+  case RECORD_QSTRING:
+    return PYLDR_STRING(ldr.str(idx).c_str(), (Py_ssize_t)ldr.str(idx).size());
+  case RECORD_GROUP:
+    return pyldr_value(holder, ldr.group(idx));
+  case RECORD_UNSET:
+  default:
+    Py_RETURN_NONE;
+  }
+}
+
+// scalars for single values, buffers for numeric arrays, lists otherwise
+static inline PyObject *
+pyldr_value(const std::shared_ptr<const Ldr> & holder, const Ldr & ldr)
+{
+  if (ldr.size() == 0)
+    Py_RETURN_NONE;
+  if (ldr.size() == 1 && ldr.type() != RECORD_GROUP)
+    return pyldr_record(holder, ldr, 0);
+
+  if (ldr.isNumeric()) {
+    PyObject * view = pyldr_view(holder, ldr);
+    if (!view)
+      return NULL;
+    PyObject * mv = PyMemoryView_FromObject(view);
+    Py_DECREF(view);
+    return mv;
+  }
+
+  PyObject * list = PyList_New((Py_ssize_t)ldr.size());
+  if (!list)
+    return NULL;
+  for (size_t ii = 0; ii < ldr.size(); ii++) {
+    PyObject * item = pyldr_record(holder, ldr, ii);
+    if (!item) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    PyList_SET_ITEM(list, (Py_ssize_t)ii, item);
+  }
+  return list;
+}
+
+//! the str (or bytes) items of the sequence 'seq', as utf-8
+static inline bool
+pyldr_strings(PyObject * seq, std::vector<string> & out)
+{
+  PyObject * fast = PySequence_Fast(seq, "expected a sequence of paths");
+  if (!fast)
+    return false;
+  Py_ssize_t nn = PySequence_Fast_GET_SIZE(fast);
+  out.clear();
+  out.reserve((size_t)nn);
+  for (Py_ssize_t ii = 0; ii < nn; ii++) {
+    PyObject * item = PySequence_Fast_GET_ITEM(fast, ii);
+    if (PyUnicode_Check(item))
+      item = PyUnicode_AsUTF8String(item);
+    else
+      Py_INCREF(item);
+    if (item && PyBytes_Check(item)) {
+      out.push_back(string(PyBytes_AS_STRING(item), (size_t)PyBytes_GET_SIZE(item)));
+      Py_DECREF(item);
+      continue;
+    }
+    if (!PyErr_Occurred())
+      PyErr_SetString(PyExc_TypeError, "paths must be strings");
+    Py_XDECREF(item);
+    Py_DECREF(fast);
+    return false;
+  }
+  Py_DECREF(fast);
+  return true;
+}
+
+//! {label: value} for every Ldr in 'ldrs', labels without the leading '$'
+static inline PyObject *
+pyldr_dict(const Ldrset & ldrs)
+{
+  PyObject * dict = PyDict_New();
+  if (!dict)
+    return NULL;
+  try {
+    for (auto & label : ldrs.getLabels()) {
+      std::shared_ptr<const Ldr> ldr = ldrs.shareLdr(label);
+      PyObject * val = pyldr_value(ldr, *ldr);
+      if (!val) {
+        Py_DECREF(dict);
+        return NULL;
+      }
+      const char * key = label.c_str();
+      if (key[0] == '$')
+        key++;
+      int rc = PyDict_SetItemString(dict, key, val);
+      Py_DECREF(val);
+      if (rc) {
+        Py_DECREF(dict);
+        return NULL;
+      }
+    }
+  }
+  catch (const std::exception & ex) {
+    Py_DECREF(dict);
+    PyErr_SetString(PyExc_RuntimeError, ex.what());
+    return NULL;
+  }
+  return dict;
+}
+
+#endif // PYLDR_HPP
@@ -12,8 +12,11 @@ jcampdx_module = Extension('_jcampdx',
                                     '../matlab/jcampdx.cpp',
                                     '../matlab/FileLoc.cpp',
                                     '../matlab/jcamp_scan.cpp',
-                                    '../matlab/jcamp_parse.cpp'],
-                           extra_compile_args=['-std=c++11'],
+                                    '../matlab/jcamp_parse.cpp',
+                                    '../matlab/brulist.cpp',
+                                    '../matlab/rawdata.cpp'],
+                           extra_compile_args=['-std=c++11', '-pthread'],
+                           extra_link_args=['-pthread'],
                            swig_opts=['-modern', '-I../matlab', '-c++'],
                            include_dirs=['../matlab/'])
 
@@ -24,5 +27,5 @@ setup (name = 'jcmapdx',
        url         ='https://www.github.com/tesch1/BruKitchen/',
        description = """Module to read JCAMP-DX parameter files""",
        ext_modules = [jcampdx_module],
-       py_modules  = ["jcampdx"],
+       py_modules  = ["jcampdx", "brudata"],
        )